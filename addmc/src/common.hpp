@@ -7,9 +7,11 @@
 #include <cassert>
 #include <iostream>
 #include <map>
+#include <vector>
 
 using std::map;
 using std::ostream;
+using std::vector;
 
 namespace dpve{
    /* diagram packages: */
@@ -61,6 +63,21 @@ namespace dpve{
     {BOUQUET_METHOD_TREE, "BOUQUET_METHOD_TREE"}
   };
 
+  /* cluster var orders tried by planner portfolio (LEX_M is too slow for big formulas, RANDOM rarely wins): */
+  inline const vector<Int> PORTFOLIO_VAR_ORDER_HEURISTICS = {
+    DECLARATION_HEURISTIC,
+    MOST_CLAUSES_HEURISTIC,
+    MIN_FILL_HEURISTIC,
+    MCS_HEURISTIC,
+    LEX_P_HEURISTIC,
+    COLAMD_HEURISTIC
+  };
+
+  /* join-tree format: */
+  inline const string JOIN_TREE_WORD = "jt";
+  inline const string BINARY_JOIN_TREE_WORD = "bjt"; // problem line also has payload byte count; nonterminal lines are replaced by varints
+  inline const string ELIM_VARS_WORD = "e";
+
   /* maximizer formats: */
   inline const Int NEITHER_FORMAT = 0;
   inline const Int SHORT_FORMAT = 1;
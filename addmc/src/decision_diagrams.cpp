@@ -2,7 +2,10 @@
 #include "io.hpp"
 #include "util.hpp"
 
+#include <sstream>
+
 using dpve::Dd;
+using dpve::ReorderPolicy;
 using dpve::Float;
 using dpve::Set;
 using dpve::Int;
@@ -11,6 +14,90 @@ using dpve::io::printLine;
 using std::to_string;
 using dpve::Map;
 
+/* class ReorderPolicy ====================================================== */
+
+bool ReorderPolicy::allows()
+{
+    if (getRemainingSeconds() <= 0) {
+        declinedCount++;
+        printLine("Reordering declined: budget of " + to_string(budgetFraction) + " of elapsed time is spent");
+        return false;
+    }
+    if (skippedTriggers > 0) {
+        skippedTriggers--;
+        declinedCount++;
+        printLine("Reordering declined: recent gain " + to_string(recentGain) + " is below " + to_string(minGain));
+        return false;
+    }
+    return true;
+}
+
+Float ReorderPolicy::getRemainingSeconds() const
+{
+    if (budgetFraction <= 0) {
+        return dpve::INF;
+    }
+    return budgetFraction * dpve::util::getDuration(startPoint) - spentSeconds;
+}
+
+Int ReorderPolicy::getSwapCap(Int maxSwaps) const
+{
+    Float remainingSeconds = getRemainingSeconds();
+    if (swapsPerSecond <= 0 || remainingSeconds == dpve::INF) {
+        return maxSwaps;
+    }
+    return std::max(std::min(maxSwaps, (Int) (swapsPerSecond * remainingSeconds)), (Int) 1);
+}
+
+Float ReorderPolicy::getCandidateScore(const vector<Int>& ddVarLevels) const
+{
+    Float score = 0;
+    for (const vector<Int>& ddVars: sampleDdVarSets) {
+        Int minLevel = dpve::MAX_INT;
+        Int maxLevel = dpve::MIN_INT;
+        for (Int ddVar: ddVars) {
+            minLevel = std::min(minLevel, ddVarLevels.at(ddVar));
+            maxLevel = std::max(maxLevel, ddVarLevels.at(ddVar));
+        }
+        score += maxLevel - minLevel; // a var set spread over fewer levels tends to give fewer nodes
+    }
+    return score;
+}
+
+void ReorderPolicy::record(Float seconds, size_t nodeCountBefore, size_t nodeCountAfter, Int swapCount)
+{
+    spentSeconds += seconds;
+    if (swapCount > 0 && seconds > 0) {
+        swapsPerSecond = swapCount / seconds;
+    }
+    Float gain = nodeCountBefore > 0 ? (nodeCountBefore - (Float) nodeCountAfter) / nodeCountBefore : 0;
+    recentGain = (recentGain + gain) / 2;
+    if (recentGain < minGain) {
+        backoffTriggers = std::max(backoffTriggers * 2, (Int) 1);
+        skippedTriggers = backoffTriggers;
+    } else {
+        backoffTriggers = 0;
+    }
+    printLine("Reordering gain: " + to_string(gain) + ", recent gain: " + to_string(recentGain) + ", spent seconds: " + to_string(spentSeconds));
+}
+
+void ReorderPolicy::setSample(const vector<vector<Int>>& ddVarSets)
+{
+    sampleDdVarSets = ddVarSets;
+}
+
+void ReorderPolicy::reset(Float budgetFraction_)
+{
+    budgetFraction = budgetFraction_;
+    declinedCount = 0;
+    spentSeconds = 0;
+    startPoint = dpve::util::getTimePoint();
+    recentGain = 1;
+    swapsPerSecond = 0;
+    backoffTriggers = 0;
+    skippedTriggers = 0;
+}
+
 /* class Dd ================================================================= */
 
 size_t Dd::maxDdLeafCount;
@@ -19,6 +106,14 @@ size_t Dd::maxDdNodeCount;
 size_t Dd::prunedDdCount;
 Float Dd::pruningDuration;
 
+Int Dd::gcCount = 0;
+Float Dd::gcDuration = 0;
+dpve::TimePoint Dd::gcStartPoint;
+Int Dd::reorderCount = 0;
+Float Dd::reorderDuration = 0;
+size_t Dd::peakTableNodeCount = 0;
+ReorderPolicy Dd::reorderPolicy;
+
 bool Dd::dynOrderEnabled = false;
 Float Dd::reordThresh, Dd::reordThreshInc;
 Int Dd::maxSwaps, Dd::maxSwapsInc, Dd::swapTime, Dd::dynVarOrdering = 0, Dd::lut;
@@ -32,6 +127,11 @@ bool Dd::weightedCounting = 0;
 bool Dd::multiplePrecision = 0;
 Int Dd::dotFileIndex = 0;
 Map<Int, pair<Number, Number>> Dd::wtMap;
+Map<Int, vector<Int>> Dd::reorderCandidates;
+bool Dd::recordingReorder = false;
+dpve::TimePoint Dd::hookReorderStartPoint;
+size_t Dd::hookNodeCountBefore = 0;
+bool Dd::autodynSuspended = false;
 
 bool Dd::enableDynamicOrdering()
 {
@@ -57,13 +157,23 @@ int Dd::postGCHook(DdManager *dd, const char *str, void *data)
     Int memMax = mgr->ReadMaxMemory();
     printLine("GC done! memused: " + to_string(memused) + " / " + to_string(memMax) + " = " +
               to_string((memused + 0.0) / memMax));
+    util::Trace::endSpan("GC");
+    gcCount++;
+    gcDuration += util::getDuration(gcStartPoint);
     noReordSinceGC = true;
+    if (autodynSuspended && reorderPolicy.allows()) { // GC counts as a trigger, as with manual reordering
+        printLine("Resuming automatic reordering");
+        mgr->AutodynEnable();
+        autodynSuspended = false;
+    }
     return 1;
 }
 
 int Dd::preGCHook(DdManager *dd, const char *str, void *data)
 {
     printLine("Starting GC..", "   ");
+    util::Trace::beginSpan("GC");
+    gcStartPoint = util::getTimePoint();
     return 1;
 }
 
@@ -73,6 +183,14 @@ int Dd::postReorderHook(DdManager *dd, const char *str, void *data)
     int retval;
     unsigned long finalTime = util_cpu_time();
     double totalTimeSec = (double) (finalTime - initialTime) / 1000.0;
+    if (!recordingReorder) { // automatic reordering, which does not pass reorder policy beforehand
+        recordReorder(hookReorderStartPoint, hookNodeCountBefore);
+        if (!reorderPolicy.allows()) {
+            printLine("Suspending automatic reordering");
+            mgr->AutodynDisable(); // until a later GC finds the policy allowing again
+            autodynSuspended = true;
+        }
+    }
 
     retval = fprintf(dd->out, "%ld nodes in %g sec\n",
                      strcmp(str, "BDD") == 0 ? Cudd_ReadNodeCount(dd) : Cudd_zddReadNodeCount(dd), totalTimeSec);
@@ -90,6 +208,10 @@ int Dd::preReorderHook(DdManager *dd, const char *str, void *data)
     data;
     int retval;
 
+    if (!recordingReorder) {
+        hookReorderStartPoint = util::getTimePoint();
+        hookNodeCountBefore = getTableNodeCount();
+    }
     retval = fprintf(dd->out, "%s reordering with ", str);
     if (retval == EOF) return (0);
     switch (method) {
@@ -407,32 +529,99 @@ Dd Dd::getAdd()
     }
 }
 
+Int Dd::getVarLevel(Int ddVar)
+{
+    if (ddPackage == CUDD_PACKAGE) {
+        return mgr->ReadPerm(ddVar);
+    }
+    return ddVar; // Sylvan orders vars by index
+}
+
+Dd Dd::getNodeDd(Int ddVar, const Dd& highDd, const Dd& lowDd)
+{
+    if (ddPackage == CUDD_PACKAGE) {
+        // ITE of a projection var above both branches makes one node without recursion, and stays valid if CUDD reorders meanwhile
+        return Dd(mgr->addVar(ddVar).Ite(highDd.cuadd, lowDd.cuadd));
+    }
+    return Dd(Mtbdd(mtbdd_makenode(ddVar, lowDd.mtbdd.GetMTBDD(), highDd.mtbdd.GetMTBDD())));
+}
+
+Dd Dd::getIteDd(Int ddVar, const Dd& highDd, const Dd& lowDd)
+{
+    if (ddPackage == CUDD_PACKAGE) {
+        return Dd(mgr->addVar(ddVar).Ite(highDd.cuadd, lowDd.cuadd));
+    }
+    return Dd(Mtbdd::mtbddVar(ddVar).Ite(highDd.mtbdd, lowDd.mtbdd));
+}
+
 /*
-First parameter has 3 elements: 
-  the ddVar for each cnfvar in the clause.
-  the sign/polarity (+1 or 0) for the ddVar
+Each literal of the clause has 3 elements: 
+  the ddVar of its cnfvar.
+  the sign/polarity (true or false) for the ddVar
   the assignment to the variable (0: unassigned, +1: positive asnmt -1: negative asnmt)
+Unassigned vars are sorted by level then the DD is built from the bottom var up:
+  a disjunction gets one node per var, whose other branch is the constant one;
+  an XOR gets two nodes per var, for even and odd parity of the vars below.
 */
-Dd Dd::getClauseDd(Map<Int, pair<Int, Int>> clauseDDVarSignAndAsmts, bool xorFlag)
+Dd Dd::getClauseDd(const vector<DdLiteral>& clauseLiterals, bool xorFlag)
 {
-    Dd clauseDd = Dd::getZeroDd();
-    for (auto [ddVar, valuePair]: clauseDDVarSignAndAsmts) {
+    bool parity = false; // XOR of satisfied and negative literals, which flip polarity
+    vector<pair<Int, Int>> levelVars; // level and ddVar of each unassigned literal
+    vector<bool> varSigns; // of each unassigned literal
+    for (const auto [ddVar, sign, asmt]: clauseLiterals) {
         assert(ddVar >= 0);
-        auto [sign, asmt] = valuePair;
-        assert(sign == 1 || sign == 0);
         assert(asmt == 1 || asmt == 0 || asmt == -1);
         if (asmt == 0) { //variable is unassigned
-            Dd literalDd = Dd::getVarDd(ddVar, sign);
-            clauseDd = xorFlag ? clauseDd.getXor(literalDd) : clauseDd.getMax(literalDd);
-        } else if ((sign > 0) == (asmt > 0)) { //literal is satisfied by assignment
+            levelVars.push_back({getVarLevel(ddVar), ddVar});
+            varSigns.push_back(sign);
+            parity ^= !sign;
+        } else if (sign == (asmt > 0)) { //literal is satisfied by assignment
             if (xorFlag) { // flips polarity
-                clauseDd = clauseDd.getXor(Dd::getOneDd());
+                parity = !parity;
             } else { // returns satisfied disjunctive clause
                 return Dd::getOneDd();
             }
         } // excludes unsatisfied literal from clause otherwise
     }
-    return clauseDd;
+    vector<Int> order(levelVars.size());
+    for (Int i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&levelVars](Int i, Int j) {
+        return levelVars[i] > levelVars[j]; // bottom var first
+    });
+
+    Dd zeroDd = Dd::getZeroDd();
+    Dd oneDd = Dd::getOneDd();
+    Dd evenDd = oneDd; // for XOR: whether vars below have even parity; for disjunction: whether some literal below is true
+    Dd oddDd = zeroDd;
+    if (!xorFlag) {
+        evenDd = zeroDd;
+    }
+    for (Int k = 0; k < order.size(); k++) {
+        Int ddVar = levelVars[order[k]].second;
+        if (k + 1 < order.size() && levelVars[order[k + 1]].second == ddVar) { // same var twice
+            if (xorFlag) { // literals cancel, or make constant one if signs differ (polarity is already flipped)
+                k++;
+                continue;
+            }
+            if (varSigns[order[k]] != varSigns[order[k + 1]]) { // tautology
+                return oneDd;
+            }
+            continue;
+        }
+        if (xorFlag) {
+            Dd nextEvenDd = getNodeDd(ddVar, oddDd, evenDd);
+            oddDd = getNodeDd(ddVar, evenDd, oddDd);
+            evenDd = nextEvenDd;
+        } else {
+            evenDd = varSigns[order[k]] ? getNodeDd(ddVar, oneDd, evenDd) : getNodeDd(ddVar, evenDd, oneDd);
+        }
+    }
+    if (xorFlag) {
+        return parity ? evenDd : oddDd;
+    }
+    return evenDd;
 }
 
 template<typename TReal>
@@ -471,18 +660,19 @@ Float Dd::getNegWt(Int ddVar)
     return negWt;
 }
 
-Dd Dd::getAbstraction(Map<Int, tuple<Number, Number, bool, Int>> ddVarWts, Float logBound,
+Dd Dd::getAbstraction(const vector<DdVarWeight>& ddVarWts, Float logBound,
                       vector<pair<Int, Dd>> &maximizationStack, bool maximizerFormat, bool substitutionMaximization,
                       Int verboseSolving)
 {
     manualReorder();
+    util::PerfScope perfScope("abstraction");
     if (atomicAbstract) {
         if (ddPackage == CUDD_PACKAGE) {
             ADD wCube = mgr->addOne();
             wtMap.clear();
-            for (auto ddVarWt: ddVarWts) {
-                Int ddVar = ddVarWt.first;
-                const auto [posWt, negWt, additiveFlag, asmt] = ddVarWt.second;
+            for (const DdVarWeight& ddVarWt: ddVarWts) {
+                Int ddVar = ddVarWt.ddVar;
+                const auto [posWt, negWt, additiveFlag, asmt] = std::tie(*ddVarWt.posWt, *ddVarWt.negWt, ddVarWt.additiveFlag, ddVarWt.asmt);
                 wtMap[ddVar] = {posWt, negWt};
                 assert(asmt == 0); //cases with assignments dont currently work with atomic abstract
                 ADD v = mgr->addVar(ddVar);
@@ -498,16 +688,16 @@ Dd Dd::getAbstraction(Map<Int, tuple<Number, Number, bool, Int>> ddVarWts, Float
             assert(!weightedCounting);
             if (multiplePrecision) {
                 Mtbdd temp = Mtbdd::mtbddOne();
-                for (auto ddVarWt: ddVarWts) {
-                    Int ddVar = ddVarWt.first;
+                for (const DdVarWeight& ddVarWt: ddVarWts) {
+                    Int ddVar = ddVarWt.ddVar;
                     assert(ddVar >= 0);
                     temp = temp.Times(Mtbdd::mtbddVar(ddVar));
                 }
                 return Dd(Mtbdd(gmp_abstract_plus(mtbdd.GetMTBDD(), temp.GetMTBDD())));
             } else {
                 sylvan::BddSet b;
-                for (auto ddVarWt: ddVarWts) {
-                    Int ddVar = ddVarWt.first;
+                for (const DdVarWeight& ddVarWt: ddVarWts) {
+                    Int ddVar = ddVarWt.ddVar;
                     b.add((uint32_t) ddVar);
                 }
                 return logCounting ? mtbdd.AbstractLogSumExp(b) : mtbdd.AbstractPlus(b);
@@ -515,9 +705,9 @@ Dd Dd::getAbstraction(Map<Int, tuple<Number, Number, bool, Int>> ddVarWts, Float
         }
     } else {
         Dd dd = *this;
-        for (auto ddVarWt: ddVarWts) {
-            Int ddVar = ddVarWt.first;
-            const auto [posWt, negWt, additiveFlag, asmt] = ddVarWt.second;
+        for (const DdVarWeight& ddVarWt: ddVarWts) {
+            Int ddVar = ddVarWt.ddVar;
+            const auto [posWt, negWt, additiveFlag, asmt] = std::tie(*ddVarWt.posWt, *ddVarWt.negWt, ddVarWt.additiveFlag, ddVarWt.asmt);
             if (asmt != 0) { //variable has an assignment
                 dd = dd.getProduct(asmt > 0 ? getConstDd(posWt) : getConstDd(negWt));
             } else {
@@ -572,6 +762,7 @@ bool Dd::operator!=(const Dd &rightDd) const
 
 Dd Dd::getComposition(Int ddVar, bool val) const
 {
+    util::PerfScope perfScope("composition");
     if (ddPackage == CUDD_PACKAGE) {
         if (dpve::util::isFound(ddVar, cuadd.SupportIndices())) {
             return Dd(cuadd.Compose(val ? mgr->addOne() : mgr->addZero(), ddVar));
@@ -586,6 +777,7 @@ Dd Dd::getComposition(Int ddVar, bool val) const
 Dd Dd::getProduct(const Dd &dd) const
 {
     manualReorder();
+    util::PerfScope perfScope("product");
     if (ddPackage == CUDD_PACKAGE) {
         return logCounting ? Dd(cuadd + dd.cuadd) : Dd(cuadd * dd.cuadd);
     }
@@ -598,6 +790,7 @@ Dd Dd::getProduct(const Dd &dd) const
 
 Dd Dd::getSum(const Dd &dd) const
 {
+    util::PerfScope perfScope("sum");
     if (ddPackage == CUDD_PACKAGE) {
         return logCounting ? Dd(cuadd.LogSumExp(dd.cuadd)) : Dd(cuadd + dd.cuadd);
     }
@@ -716,6 +909,119 @@ void Dd::writeDotFile(const string &dotFileDir) const
     printLine("wrote decision diagram to file " + filePath);
 }
 
+/*
+Text format, one node per line after the node count, children before parents and root last:
+  l <value>: leaf, as hexadecimal float or as quotient if multiplePrecision
+  n <cnfVar> <high> <low>: inner node, with children as line indices
+Leaf values are stored as they are, so the reader must use the same DD package, logCounting and multiplePrecision.
+*/
+bool Dd::writeNodes(std::ostream& out, const vector<Int>& ddVarToCnfVarMap) const
+{
+    vector<string> nodeLines;
+    Map<uint64_t, Int> nodeIndices; // DdNode* or MTBDD |-> line index
+    auto getLeafLine = [](Float value) {
+        std::ostringstream stream;
+        stream << "l " << std::hexfloat << value; // exact
+        return stream.str();
+    };
+
+    if (ddPackage == CUDD_PACKAGE) {
+        vector<pair<DdNode*, bool>> nodeStack{{cuadd.getNode(), false}}; // node, whether children are written
+        while (!nodeStack.empty()) {
+            auto [node, expanded] = nodeStack.back();
+            nodeStack.pop_back();
+            uint64_t key = reinterpret_cast<uint64_t>(node);
+            if (nodeIndices.contains(key)) {
+                continue;
+            }
+            if (Cudd_IsConstant(node)) {
+                nodeIndices[key] = nodeLines.size();
+                nodeLines.push_back(getLeafLine(cuddV(node)));
+            } else if (!expanded) {
+                nodeStack.push_back({node, true});
+                nodeStack.push_back({Cudd_E(node), false});
+                nodeStack.push_back({Cudd_T(node), false});
+            } else {
+                nodeIndices[key] = nodeLines.size();
+                nodeLines.push_back("n " + to_string(ddVarToCnfVarMap.at(Cudd_NodeReadIndex(node))) + " " +
+                    to_string(nodeIndices.at(reinterpret_cast<uint64_t>(Cudd_T(node)))) + " " + to_string(nodeIndices.at(reinterpret_cast<uint64_t>(Cudd_E(node)))));
+            }
+        }
+    } else {
+        MTBDD booleanLeaves[] = {Mtbdd::mtbddZero().GetMTBDD(), Mtbdd::mtbddOne().GetMTBDD()};
+        vector<pair<MTBDD, bool>> nodeStack{{mtbdd.GetMTBDD(), false}};
+        while (!nodeStack.empty()) {
+            auto [node, expanded] = nodeStack.back();
+            nodeStack.pop_back();
+            if (nodeIndices.contains(node)) {
+                continue;
+            }
+            if (node == booleanLeaves[0] || node == booleanLeaves[1]) {
+                return false;
+            }
+            if (mtbdd_isleaf(node)) {
+                nodeIndices[node] = nodeLines.size();
+                if (multiplePrecision) {
+                    mpq_class value((mpq_ptr) mtbdd_getvalue(node));
+                    nodeLines.push_back("l " + value.get_str());
+                } else {
+                    nodeLines.push_back(getLeafLine(mtbdd_getdouble(node)));
+                }
+            } else if (!expanded) {
+                nodeStack.push_back({node, true});
+                nodeStack.push_back({mtbdd_getlow(node), false});
+                nodeStack.push_back({mtbdd_gethigh(node), false});
+            } else {
+                nodeIndices[node] = nodeLines.size();
+                nodeLines.push_back("n " + to_string(ddVarToCnfVarMap.at(mtbdd_getvar(node))) + " " +
+                    to_string(nodeIndices.at(mtbdd_gethigh(node))) + " " + to_string(nodeIndices.at(mtbdd_getlow(node))));
+            }
+        }
+    }
+
+    out << nodeLines.size() << "\n";
+    for (const string& line : nodeLines) {
+        out << line << "\n";
+    }
+    return bool(out);
+}
+
+Dd Dd::readNodes(std::istream& in, const vector<Int>& cnfVarToDdVarMap)
+{
+    Int nodeCount = 0;
+    if (!(in >> nodeCount) || nodeCount <= 0) {
+        throw util::MyError("diagram file has no nodes");
+    }
+    vector<Dd> nodeDds; // by line index
+    nodeDds.reserve(nodeCount);
+    for (Int lineIndex = 0; lineIndex < nodeCount; lineIndex++) {
+        string kind;
+        in >> kind;
+        if (kind == "l") {
+            string value;
+            in >> value;
+            if (ddPackage == SYLVAN_PACKAGE && multiplePrecision) {
+                mpq_class q(value);
+                nodeDds.push_back(Dd(Mtbdd(mtbdd_gmp(q.get_mpq_t()))));
+            } else {
+                Float f = std::strtold(value.c_str(), nullptr); // also parses hexadecimal and infinite values
+                nodeDds.push_back(ddPackage == CUDD_PACKAGE ? Dd(mgr->constant(f)) : Dd(Mtbdd::doubleTerminal(f)));
+            }
+        } else if (kind == "n") {
+            Int cnfVar, highIndex, lowIndex;
+            in >> cnfVar >> highIndex >> lowIndex;
+            if (!in || cnfVar <= 0 || cnfVar >= cnfVarToDdVarMap.size() || cnfVarToDdVarMap.at(cnfVar) < 0 ||
+                highIndex < 0 || highIndex >= lineIndex || lowIndex < 0 || lowIndex >= lineIndex) {
+                throw util::MyError("diagram file has wrong node on line ", lineIndex + 2);
+            }
+            nodeDds.push_back(getIteDd(cnfVarToDdVarMap.at(cnfVar), nodeDds.at(highIndex), nodeDds.at(lowIndex)));
+        } else {
+            throw util::MyError("diagram file has wrong node on line ", lineIndex + 2);
+        }
+    }
+    return nodeDds.back();
+}
+
 void Dd::writeInfoFile(const string &filePath)
 {
     assert(ddPackage == CUDD_PACKAGE);
@@ -751,12 +1057,18 @@ VOID_TASK_0(gc_start)
     size_t used, total;
     sylvan::sylvan_table_usage_RUN(&used, &total);
     printLine("Sylvan before GC. Used : " + to_string(used) + " out of " + to_string(total), "\n");
+    dpve::util::Trace::beginSpan("GC");
+    Dd::gcStartPoint = dpve::util::getTimePoint();
+    Dd::peakTableNodeCount = std::max(Dd::peakTableNodeCount, used);
 }
 
 VOID_TASK_0(gc_end)
 {
     size_t used, total;
     sylvan::sylvan_table_usage_RUN(&used, &total);
+    dpve::util::Trace::endSpan("GC");
+    Dd::gcCount++;
+    Dd::gcDuration += dpve::util::getDuration(Dd::gcStartPoint);
     Dd::noReordSinceGC = true;
     printLine("Sylvan after GC.  Used : " + to_string(used) + " out of " + to_string(total));
 }
@@ -843,83 +1155,142 @@ void Dd::afterReorder()
     didReordering = false;
 }
 
-void Dd::manualReorderCUDD1(Map<Int, vector<Int>> levelMaps)
+void Dd::manualReorderCUDD1(const Map<Int, vector<Int>>& levelMaps)
 {
-    DdManager *m = mgr->getManager();
-    assert(ddReorderPreprocess(m));
-    Int initialSize = m->keys - m->isolated;
-    int *perm = new int[mgr->ReadSize()];
-    Int minSize = initialSize;
-    Int minVOInd = 0; //unchanged
-    vector<Int> initialVO(mgr->ReadSize(), -1);
-    for (int i = 0; i < mgr->ReadSize(); i++) {
-        initialVO[mgr->ReadPerm(i)] = i; //inverted so as to allow easy restoring later
+    vector<Int> ddVarLevels(mgr->ReadSize());
+    for (int ddVar = 0; ddVar < mgr->ReadSize(); ddVar++) {
+        ddVarLevels[ddVar] = mgr->ReadPerm(ddVar);
     }
-    for (auto [i, vo]: levelMaps) {
-        assert (i != 0);
+    Float minScore = reorderPolicy.getCandidateScore(ddVarLevels); // of current order
+    const vector<Int>* minVO = nullptr;
+    for (const auto& [i, vo]: levelMaps) {
+        assert(i != 0);
         assert(vo.size() == mgr->ReadSize());
-        for (int j = 0; j < vo.size(); j++) {
-            perm[j] = vo[j];
+        for (int level = 0; level < vo.size(); level++) {
+            ddVarLevels[vo[level]] = level;
         }
-        // cout<<"0\n";
-        mgr->ShuffleHeap(perm);
-        // cout<<"1\n";
-        Int newSize = m->keys - m->isolated;
-        if (newSize < minSize) {
-            minSize = newSize;
-            minVOInd = i;
+        Float score = reorderPolicy.getCandidateScore(ddVarLevels);
+        if (score < minScore) {
+            minScore = score;
+            minVO = &vo;
         }
     }
-    if (minVOInd != 0) {
-        auto minVO = levelMaps[minVOInd];
-        for (int j = 0; j < minVO.size(); j++) {
-            perm[j] = minVO[j];
-        }
-        mgr->ShuffleHeap(perm);
-    } else {   // restore initialVO
-        assert(minSize == initialSize);
-        for (int j = 0; j < initialVO.size(); j++) {
-            perm[j] = initialVO[j];
-        }
-        mgr->ShuffleHeap(perm);
+    if (minVO != nullptr) { // one shuffle instead of one per candidate
+        vector<int> perm(minVO->begin(), minVO->end());
+        mgr->ShuffleHeap(perm.data());
     }
-    delete perm;
 }
 
 void Dd::manualReorderCUDD2()
 {
+    mgr->SetSiftMaxSwap(reorderPolicy.getSwapCap(maxSwaps));
     mgr->ReduceHeap(CUDD_REORDER_GROUP_SIFT);
     // mgr->ReduceHeap(CUDD_REORDER_SIFT); //in one test this took 294 secs compared to 299 secs for the symmetric version. So not much difference.
 }
 
-void Dd::manualReorder(Map<Int, vector<Int>> levelMaps)
+bool Dd::forceReorder()
+{
+    if (ddPackage == SYLVAN_PACKAGE && dynVarOrdering == 0) {
+        return false;
+    }
+    util::PerfScope perfScope("reorder");
+    TimePoint reordStart = util::getTimePoint();
+    size_t nodeCountBefore = getTableNodeCount();
+    recordingReorder = true;
+    if (ddPackage == SYLVAN_PACKAGE) {
+        sylvan::Sylvan::reduceHeap();
+    } else {
+        manualReorderCUDD2();
+    }
+    recordingReorder = false;
+    recordReorder(reordStart, nodeCountBefore); // counted against budget, though the governor is not limited by it
+    return true;
+}
+
+void Dd::collectGarbage()
+{
+    if (ddPackage == SYLVAN_PACKAGE) {
+        sylvan::sylvan_gc_RUN(); // runs hooks
+    } else {
+        cuddGarbageCollect(mgr->getManager(), 1); // runs hooks; clears cache, whose entries may point to dead nodes
+    }
+}
+
+void Dd::readTableStats(size_t& nodeCount, size_t& slotCount, Float& cacheHitRate)
+{
+    if (ddPackage == SYLVAN_PACKAGE) {
+        sylvan::sylvan_table_usage_RUN(&nodeCount, &slotCount);
+        cacheHitRate = -1;
+    } else {
+        nodeCount = mgr->ReadKeys();
+        slotCount = mgr->ReadSlots();
+        double lookUps = mgr->ReadCacheLookUps();
+        cacheHitRate = lookUps > 0 ? mgr->ReadCacheHits() / lookUps : 0;
+    }
+}
+
+size_t Dd::getTableNodeCount()
+{
+    if (ddPackage == SYLVAN_PACKAGE) {
+        size_t used, total;
+        sylvan::sylvan_table_usage_RUN(&used, &total);
+        return used;
+    }
+    return mgr->ReadNodeCount();
+}
+
+void Dd::recordReorder(TimePoint reordStart, size_t nodeCountBefore)
+{
+    Float duration = util::getDuration(reordStart);
+    Int swapCount = ddPackage == CUDD_PACKAGE ? mgr->getManager()->ddTotalNumberSwapping : 0; // reset by each CUDD reordering
+    reorderPolicy.record(duration, nodeCountBefore, getTableNodeCount(), swapCount);
+    util::Trace::addSpan("reorder", reordStart, util::getTimePoint());
+    reorderCount++;
+    reorderDuration += duration;
+}
+
+void Dd::setReorderCandidates(const Map<Int, vector<Int>>& levelMaps)
+{
+    reorderCandidates = levelMaps;
+}
+
+void Dd::manualReorder(const Map<Int, vector<Int>>& levelMaps)
 {
     if (dynVarOrdering != 1 && dynVarOrdering != 2) {
         return;
     }
     if (beforeReorder()) {
+        if (!reorderPolicy.allows()) {
+            noReordSinceGC = false; // asks again after next GC instead of on every operation
+            return;
+        }
         didReordering = true;
+        util::PerfScope perfScope("reorder");
         TimePoint reordStart = util::getTimePoint();
+        size_t nodeCountBefore = getTableNodeCount();
         printLine("Starting reordering..");
+        recordingReorder = true;
         if (ddPackage == SYLVAN_PACKAGE) {
-            sylvan::Sylvan::reduceHeap();
+            sylvan::Sylvan::reduceHeap(); // parallel sifting on Lace workers
         } else { //CUDD_PACKAGE
-            printLine("NodeCount before reordering: " + to_string(mgr->ReadNodeCount()));
+            printLine("NodeCount before reordering: " + to_string(nodeCountBefore));
             if (dynVarOrdering == 1) {
-                manualReorderCUDD1(levelMaps);
+                manualReorderCUDD1(levelMaps.empty() ? reorderCandidates : levelMaps);
             } else { //dynVarOrdering == 2
                 manualReorderCUDD2();
             }
             printLine("NodeCount after reordering: " + to_string(mgr->ReadNodeCount()));
         }
+        recordingReorder = false;
         afterReorder();
+        recordReorder(reordStart, nodeCountBefore);
         printLine("Reordering done! Time taken: " + to_string(util::getDuration(reordStart)));
     }
 }
 
 void Dd::init(string ddPackage_, Int numVars, bool logCounting_, bool atomicAbstract_, bool weightedCounting_,
               bool multiplePrecision_, Int tableRatio, Int initRatio, Int threadCount, Float maxMem,
-              Int dynVarOrdering_, Int dotFileIndex_)
+              Int dynVarOrdering_, Int dotFileIndex_, Float reorderBudget)
 {
     ddPackage = ddPackage_;
     logCounting = logCounting_;
@@ -935,6 +1306,8 @@ void Dd::init(string ddPackage_, Int numVars, bool logCounting_, bool atomicAbst
     maxSwapsInc = 250;
     swapTime = 15;
     noReordSinceGC = false;
+    autodynSuspended = false;
+    reorderPolicy.reset(reorderBudget);
 
     if (ddPackage == CUDD_PACKAGE) {
         mgr = new Cudd(
@@ -990,6 +1363,22 @@ void Dd::init(string ddPackage_, Int numVars, bool logCounting_, bool atomicAbst
 
 void Dd::stop()
 {
+    if (ddPackage == SYLVAN_PACKAGE) {
+        size_t used, total;
+        sylvan::sylvan_table_usage_RUN(&used, &total);
+        peakTableNodeCount = std::max(peakTableNodeCount, used);
+    } else {
+        peakTableNodeCount = mgr->ReadPeakNodeCount();
+    }
+    io::Report::add("diagrams", "peakTableNodes", peakTableNodeCount);
+    io::Report::add("diagrams", "gcCount", gcCount);
+    io::Report::add("diagrams", "gcSeconds", gcDuration);
+    io::Report::add("diagrams", "reorderCount", reorderCount);
+    io::Report::add("diagrams", "reorderSeconds", reorderDuration);
+    io::Report::add("diagrams", "declinedReorders", reorderPolicy.declinedCount);
+    io::Report::add("diagrams", "prunedDiagrams", prunedDdCount);
+    io::Report::add("diagrams", "pruningSeconds", pruningDuration);
+
     if (ddPackage == SYLVAN_PACKAGE) { // quits Sylvan
         sylvan::sylvan_quit();
         lace_stop();
@@ -34,7 +34,11 @@ using sylvan::mtbdd_uapply_RUN;
 using sylvan::mtbdd_apply_CALL;
 using sylvan::mtbdd_fprintdot_nc;
 using sylvan::mtbdd_getdouble;
+using sylvan::mtbdd_gethigh;
+using sylvan::mtbdd_getlow;
 using sylvan::mtbdd_getvalue;
+using sylvan::mtbdd_getvar;
+using sylvan::mtbdd_isleaf;
 using sylvan::mtbdd_gmp;
 using sylvan::mtbdd_leafcount_more;
 using sylvan::mtbdd_makenode;
@@ -54,6 +58,46 @@ using std::tuple;
 
 namespace dpve{
 
+class DdLiteral { // for Dd::getClauseDd
+public:
+  Int ddVar;
+  bool sign; // true for positive literal
+  Int asmt; // 0: unassigned, +1: positive asnmt, -1: negative asnmt
+};
+
+class DdVarWeight { // for Dd::getAbstraction
+public:
+  Int ddVar;
+  const Number* posWt; // owned by caller, not copied per abstraction
+  const Number* negWt;
+  bool additiveFlag;
+  Int asmt; // 0: unassigned, +1: positive asnmt, -1: negative asnmt
+};
+
+class ReorderPolicy { // whether a triggered reorder runs and how long it may take, from cost and benefit of recent reorders
+public:
+  Float budgetFraction = 0; // total reorder time is capped at this fraction of time since init; 0 for no cap
+  Float minGain = 0.05; // relative node reduction below which a reorder was not worth it
+  Int declinedCount = 0;
+  Float spentSeconds = 0;
+
+  bool allows(); // when thresholds trigger; false if budget is spent or recent reorders did not pay off
+  Float getRemainingSeconds() const; // of budget; infinite if there is no cap
+  Int getSwapCap(Int maxSwaps) const; // CUDD sifting swaps that fit remaining budget at measured swap rate
+  Float getCandidateScore(const vector<Int>& ddVarLevels) const; // total level span of sampled var sets; lower is better
+  void record(Float seconds, size_t nodeCountBefore, size_t nodeCountAfter, Int swapCount = 0);
+  void setSample(const vector<vector<Int>>& ddVarSets); // e.g. clauses, for scoring candidate orders without touching heap
+  void reset(Float budgetFraction);
+
+private:
+  TimePoint startPoint;
+  Float recentGain = 1; // exponentially averaged
+  Float swapsPerSecond = 0; // of latest sifting, 0 if unmeasured
+  Int backoffTriggers = 0; // doubled after each unprofitable reorder
+  Int skippedTriggers = 0; // left to skip
+  vector<vector<Int>> sampleDdVarSets;
+};
+
 class Dd { // wrapper for CUDD and Sylvan
 public:
   ADD cuadd; // CUDD
@@ -67,6 +111,15 @@ public:
 
   static size_t prunedDdCount;
   static Float pruningDuration;
+
+  /* for run report; public for Sylvan hooks, which are not members of Dd: */
+  static Int gcCount;
+  static Float gcDuration;
+  static TimePoint gcStartPoint;
+  static Int reorderCount;
+  static Float reorderDuration;
+  static size_t peakTableNodeCount; // of unique table, updated before each GC and at stop with Sylvan
+  static ReorderPolicy reorderPolicy;
  
   static bool dynOrderEnabled;
 
@@ -97,10 +150,12 @@ public:
   
   static Float getNegWt(Int ddVar);
   //getAbstraction is not a const method
-  Dd getAbstraction(Map<Int,tuple<Number,Number,bool,Int>> ddVarWts, Float logBound, vector<pair<Int, Dd>>& maximizationStack, bool maximizerFormat, bool substitutionMaximization, Int verboseSolving);
+  Dd getAbstraction(const vector<DdVarWeight>& ddVarWts, Float logBound, vector<pair<Int, Dd>>& maximizationStack, bool maximizerFormat, bool substitutionMaximization, Int verboseSolving);
   
   Dd getPrunedDd(Float lowerBound) const;
   void writeDotFile(const string& dotFileDir = "./") const;
+  bool writeNodes(std::ostream& out, const vector<Int>& ddVarToCnfVarMap) const; // by CNF var, so readable under another var order; false for Boolean leaves
+  static Dd readNodes(std::istream& in, const vector<Int>& cnfVarToDdVarMap);
   static void writeInfoFile(const string& filePath);
   
   static bool enableDynamicOrdering();
@@ -126,16 +181,20 @@ public:
   Dd getFilteredBdd(const Dd);
   Dd getAdd();
 
-  static Dd getClauseDd(Map<Int, pair<Int,Int>> clauseDDVarSignAndAsmts, bool xorFlag);
+  static Dd getClauseDd(const vector<DdLiteral>& clauseLiterals, bool xorFlag); // bottom-up in one pass, without apply operations
 
-  static void init(string ddPackage_, Int numVars, bool logCounting_, bool atomicAbstract_=1, bool weightedCounting_=0, bool multiplePrecision_=0, Int tableRatio=0, Int initRatio=0, Int threadCount=1, Float maxMem=0, Int dynVarOrdering_=0, Int dotFileIndex_=0);
+  static void init(string ddPackage_, Int numVars, bool logCounting_, bool atomicAbstract_=1, bool weightedCounting_=0, bool multiplePrecision_=0, Int tableRatio=0, Int initRatio=0, Int threadCount=1, Float maxMem=0, Int dynVarOrdering_=0, Int dotFileIndex_=0, Float reorderBudget=0);
   static void stop();
   
   
-  static void manualReorder(Map<Int, vector<Int>> levelMaps = Map<Int, vector<Int>>());
+  static void manualReorder(const Map<Int, vector<Int>>& levelMaps = Map<Int, vector<Int>>()); // empty levelMaps for candidates of setReorderCandidates
+  static void setReorderCandidates(const Map<Int, vector<Int>>& levelMaps); // var orders for CUDD reordering with dynVarOrdering 1
+  static bool forceReorder(); // sifting regardless of beforeReorder, e.g. by memory governor; false if Sylvan reordering is not initialized
+  static void collectGarbage(); // e.g. by memory governor
+  static void readTableStats(size_t& nodeCount, size_t& slotCount, Float& cacheHitRate); // cacheHitRate is -1 if unknown (Sylvan without stats)
   static bool beforeReorder();
   static void afterReorder();
-  static void manualReorderCUDD1(Map<Int, vector<Int>> levelMaps);
+  static void manualReorderCUDD1(const Map<Int, vector<Int>>& levelMaps); // shuffles heap once, to candidate with best sample score
   static void manualReorderCUDD2();
   
   static bool noReordSinceGC; // needs to be public for sylvan gc hook which is not a member of Dd
@@ -153,5 +212,16 @@ public:
     static Int maxSwaps, maxSwapsInc, swapTime;
     static bool didReordering; 
     static Map<Int, pair<Number,Number>> wtMap; 
+    static Map<Int, vector<Int>> reorderCandidates;
+    static bool recordingReorder; // inside manualReorder or forceReorder, so that CUDD reorder hooks leave it to recordReorder
+    static TimePoint hookReorderStartPoint; // of automatic CUDD reordering with dynVarOrdering 3
+    static size_t hookNodeCountBefore;
+    static bool autodynSuspended; // while reorder policy declines automatic CUDD reordering
+
+    static size_t getTableNodeCount(); // live nodes with CUDD, used unique-table entries with Sylvan
+    static void recordReorder(TimePoint reordStart, size_t nodeCountBefore); // cost and benefit for policy, stats for report and trace
+    static Int getVarLevel(Int ddVar); // current position in var order, 0 at top
+    static Dd getNodeDd(Int ddVar, const Dd& highDd, const Dd& lowDd); // ddVar must be above both children
+    static Dd getIteDd(Int ddVar, const Dd& highDd, const Dd& lowDd); // in any var order
 };
 } //end namespace dpve
\ No newline at end of file
@@ -2,8 +2,16 @@
 #include "util.hpp"
 #include "util/util.h"
 
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <queue>
+#include <sstream>
 #include <tuple>
+#include <sys/resource.h>
+#include <unistd.h>
 /* class SatFilter =========================================================== */
 
 using std::tuple;
@@ -13,6 +21,9 @@ using dpve::io::printLine;
 using dpve::Dd;
 using dpve::Number;
 using dpve::SatFilter;
+using dpve::SubtreeCache;
+using dpve::Checkpoint;
+using dpve::Monitor;
 using dpve::Executor;
 using dpve::Dpve;
 using dpve::Assignment;
@@ -25,39 +36,31 @@ Dd SatFilter::getClauseBdd(const Clause& clause){
   for (Int literal : clause) {
     bool val = literal > 0;
     Int cnfVar = abs(literal);
-    Int ddVar = cnfVarToDdVarMap.at(cnfVar);
+    Int ddVar = cnfVarToDdVarMap[cnfVar];
     Dd literalDd = Dd::getVarBdd(ddVar, val);
     clauseDd = clauseDd.getBddOr(literalDd);
   }
   return clauseDd;
 }
 
-Dd SatFilter::solveSubtree(const JoinNode* joinNode) {
-  if (joinNode->isTerminal()) {
-    TimePoint terminalStartPoint = dpve::util::getTimePoint();
-    // cout << "c 1\n";
-    Dd d = getClauseBdd(cnf.clauses.at(joinNode->nodeIndex));
-    ((JoinNode*) joinNode)->dd = (void*) new Dd(Dd::getOneBdd()); //cast away const-ness of joinNode to modify dd. Should be fine since object itself is not const
-    joinNodesProcessed ++;
-    if (((joinNodesProcessed-1)%(std::max((JoinNode::nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(JoinNode::nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
-    return d;
-  }
+Dd SatFilter::solveTree(const JoinTree& joinTree) {
+  Int nodeCount = joinTree.declaredNodeCount;
+  nodeBdds.assign(nodeCount, Dd::getOneBdd());
+  vector<Dd> childDdStack; // DDs of solved nodes whose parents are unsolved, in post order
+  for (Int node : joinTree.postOrder) {
+    if (joinTree.isTerminal(node)) {
+      childDdStack.push_back(getClauseBdd(cnf.clauses.at(node)));
+      joinNodesProcessed ++;
+      if (((joinNodesProcessed-1)%(std::max((nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
+      continue;
+    }
 
-  // cout << "c 3\n";
-  Dd prod = Dd::getOneBdd();
-  
-  if (joinPriority == FCFS){
-    for (JoinNode* child : joinNode->children) {
-      prod = prod.getBddAnd(solveSubtree(child));
-    }  
-  } else {
-    vector<Dd> childDdList;
-    for (JoinNode* child : joinNode->children) {
-      // cout << "c before recurse\n";
-      childDdList.push_back(solveSubtree(child));
-    }
-
-    if (joinPriority == ARBITRARY_PAIR) { // arbitrarily multiplies child decision diagrams
+    auto firstChildDd = childDdStack.end() - joinTree.getChildren(node).size();
+    vector<Dd> childDdList(firstChildDd, childDdStack.end());
+    childDdStack.erase(firstChildDd, childDdStack.end());
+
+    Dd prod = Dd::getOneBdd();
+    if (joinPriority == FCFS || joinPriority == ARBITRARY_PAIR) { // multiplies child decision diagrams in order
       for (Dd childDd : childDdList) {
         prod = prod.getBddAnd(childDd);
       }
@@ -86,133 +89,522 @@ Dd SatFilter::solveSubtree(const JoinNode* joinNode) {
       }
       prod = childDdQueue.top();
     }
+
+    std::span<const Int> projectionVars = joinTree.getProjectionVars(node);
+    if (projectionVars.size()>0){
+      nodeBdds.at(node) = prod; // kept for executor
+      vector<Int> ddVars;
+      for (Int cnfVar : projectionVars) {
+        ddVars.push_back(cnfVarToDdVarMap[cnfVar]);
+      }
+      prod = prod.getBddExists(ddVars, ddVarToCnfVarMap);
+    }
+    childDdStack.push_back(prod);
+    joinNodesProcessed ++;
+    if (((joinNodesProcessed-1)%(std::max((nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
   }
-  Dd retDD = Dd::getOneDd();
-  if (joinNode->projectionVars.size()>0){
-    ((JoinNode*) joinNode)->dd = (void*) new Dd(prod); //to make sure it does not go out of scope since we are storing a pointer
-    //cast away const-ness of joinNode to modify dd. Should be fine since object itself is not const
-    
-    vector<Int> ddVars;
-    for (Int cnfVar : joinNode->projectionVars) {
-      ddVars.push_back(cnfVarToDdVarMap.at(cnfVar));
+  return childDdStack.back();
+}
+
+bool SatFilter::filterBdds(const JoinTree& joinTree, Dd parentBdd){
+  Int nodeCount = joinTree.declaredNodeCount;
+
+  // top-down: BDD of node with projection vars is filtered by BDD of nearest such ancestor
+  vector<pair<Int, Dd>> nodeStack{{joinTree.getRoot(), parentBdd}}; // node, filtered BDD of nearest ancestor with projection vars
+  while (!nodeStack.empty()) {
+    auto [node, ancestorBdd] = nodeStack.back();
+    nodeStack.pop_back();
+    Dd nodeBdd = ancestorBdd;
+    if (joinTree.getProjectionVars(node).size()>0){
+      nodeBdds.at(node) = nodeBdds.at(node).getFilteredBdd(ancestorBdd);
+      nodeBdd = nodeBdds.at(node);
+    }
+    std::span<const Int> children = joinTree.getChildren(node);
+    for (auto child = children.rbegin(); child != children.rend(); child++) { // first child on top
+      nodeStack.push_back({*child, nodeBdd});
     }
-    // cout << "c 7\n";
-    retDD = prod.getBddExists(ddVars, ddVarToCnfVarMap);
-  } else{
-    ((JoinNode*) joinNode)->dd = (void*) new Dd(Dd::getOneBdd()); //cast away const-ness of joinNode to modify dd. Should be fine since object itself is not const
-    retDD = prod;
-  }
-  joinNodesProcessed ++;
-  if (((joinNodesProcessed-1)%(std::max((JoinNode::nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(JoinNode::nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
-  // cout << "c 8\n";
-  return retDD;
-}
-
-bool SatFilter::filterBdds(const JoinNode* joinNode, Dd parentBdd){
-  Dd* d = (Dd*)joinNode->dd;
-  bool hasNewClsDescendents = false;
-  bool bottomMost = true; //joinnode with projvars.size>0 and at least one jointerminal descendant. 
-  //joinnode->dd should not be set to one if true, as it will be used by executor.
-  if (joinNode->isTerminal()){
-    hasNewClsDescendents = true;
-  }
-  if (joinNode->projectionVars.size()==0){
-    d = &parentBdd;   // okay since *d gets passed to filterBdds below
-    bottomMost = false;
-  } else{
-    *(Dd*)(((JoinNode*) joinNode)->dd) = d->getFilteredBdd(parentBdd);
-    assert(d == (Dd*)joinNode->dd); 
-    bottomMost = true;
-    hasNewClsDescendents = false;
-  }
-  // if bottommost is false it should remain false no matter what
-  // if it is true, it should become false if even one other value is true
-  // so take OR of return values of children, take negation of that, and take and of that
-  // by demorgans law it'll be bottomost &= !filterbdds
-  for (JoinNode* child : joinNode->children) {
-    hasNewClsDescendents |= (filterBdds(child, *d)); // bitwise & so that no short-circuiting happens
-  }
-  if (hasNewClsDescendents && bottomMost){
-    //do nothing
-  } else{
-    *(Dd*)(((JoinNode*) joinNode)->dd) = Dd::getOneBdd();
   }
-  joinNodesProcessed ++;
-  if(joinNodesProcessed>JoinNode::nodeCount){
-    joinNodesProcessed=1;
+
+  // bottom-up: only bottommost nodes keep BDDs, i.e. nodes with projection vars and at least one terminal descendant
+  // joinnode bdd should not be set to one if kept, as it will be used by executor.
+  vector<bool> childFlagStack; // whether solved nodes whose parents are unsolved have new clause descendents, in post order
+  for (Int node : joinTree.postOrder) {
+    bool bottomMost = joinTree.getProjectionVars(node).size()>0;
+    bool hasNewClsDescendents = joinTree.isTerminal(node);
+    auto firstChildFlag = childFlagStack.end() - joinTree.getChildren(node).size();
+    for (auto childFlag = firstChildFlag; childFlag != childFlagStack.end(); childFlag++) {
+      hasNewClsDescendents = hasNewClsDescendents || *childFlag;
+    }
+    childFlagStack.erase(firstChildFlag, childFlagStack.end());
+    if (!(hasNewClsDescendents && bottomMost)){
+      nodeBdds.at(node) = Dd::getOneBdd();
+    }
+    childFlagStack.push_back(hasNewClsDescendents);
+
+    joinNodesProcessed ++;
+    if(joinNodesProcessed>nodeCount){
+      joinNodesProcessed=1;
+    }
+    if (((joinNodesProcessed-1)%(std::max((nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
   }
-  if (((joinNodesProcessed-1)%(std::max((JoinNode::nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(JoinNode::nodeCount)+":"+to_string(util::getDuration(satFilterStartPoint))+" ");
-  return hasNewClsDescendents;
+  return childFlagStack.back();
 }
 
-SatFilter::SatFilter(const Cnf& cnf, const Map<Int, Int>& cnfVarToDdVarMap,const vector<Int>& ddVarToCnfVarMap):
-cnf(cnf), cnfVarToDdVarMap(cnfVarToDdVarMap), ddVarToCnfVarMap(ddVarToCnfVarMap)
+SatFilter::SatFilter(const Cnf& cnf, const vector<Int>& cnfVarToDdVarMap,const vector<Int>& ddVarToCnfVarMap, vector<Dd>& nodeBdds):
+cnf(cnf), cnfVarToDdVarMap(cnfVarToDdVarMap), ddVarToCnfVarMap(ddVarToCnfVarMap), nodeBdds(nodeBdds)
 {
   joinNodesProcessed = 0;
   satFilterStartPoint = util::getTimePoint();
 }
 
+/* class SubtreeCache ======================================================= */
+
+bool SubtreeCache::hasDd(uint64_t subtreeHash) const {
+  return cachedHashes.contains(subtreeHash);
+}
+
+string SubtreeCache::getFilePath(uint64_t subtreeHash) const {
+  return dirPath + "/" + util::getHexString(subtreeHash) + ".dd";
+}
+
+Dd SubtreeCache::loadDd(uint64_t subtreeHash, const vector<Int>& cnfVarToDdVarMap) {
+  std::ifstream file(getFilePath(subtreeHash));
+  if (!file) {
+    throw util::MyError("unable to open diagram cache file ", getFilePath(subtreeHash));
+  }
+  loadedDdCount++;
+  return Dd::readNodes(file, cnfVarToDdVarMap);
+}
+
+void SubtreeCache::storeDd(uint64_t subtreeHash, const Dd& dd, const vector<Int>& ddVarToCnfVarMap) {
+  if (hasDd(subtreeHash)) {
+    return;
+  }
+  string filePath = getFilePath(subtreeHash);
+  string tempFilePath = filePath + "." + to_string(getpid()); // then renamed, so that concurrent runs never read a partial file
+  bool written;
+  {
+    std::ofstream file(tempFilePath);
+    written = dd.writeNodes(file, ddVarToCnfVarMap);
+  }
+  if (!written) {
+    std::filesystem::remove(tempFilePath);
+    return;
+  }
+  std::filesystem::rename(tempFilePath, filePath);
+  cachedHashes.insert(subtreeHash);
+  storedDdCount++;
+}
+
+SubtreeCache::SubtreeCache(const string& cacheDir, const string& ddMode, Float minSeconds):
+  minSeconds(minSeconds), dirPath(cacheDir + "/" + ddMode) {
+  std::filesystem::create_directories(dirPath);
+  for (const auto& entry : std::filesystem::directory_iterator(dirPath)) {
+    string fileName = entry.path().filename().string();
+    uint64_t subtreeHash;
+    if (fileName.size() == 19 && fileName.ends_with(".dd") && std::from_chars(fileName.data(), fileName.data() + 16, subtreeHash, 16).ec == std::errc()) {
+      cachedHashes.insert(subtreeHash);
+    }
+  }
+  printRow("cachedSubtreeDiagrams", cachedHashes.size());
+}
+
+/* class Checkpoint ========================================================= */
+
+bool Checkpoint::isDue() const {
+  return util::getDuration(latestWritePoint) >= intervalSeconds;
+}
+
+void Checkpoint::write(Int position, const vector<Dd>& childDdStack, const vector<Int>& ddVarToCnfVarMap, const vector<Int>& loadedPositions) {
+  TimePoint writeStartPoint = util::getTimePoint();
+  string tempFilePath = filePath + "." + to_string(getpid()); // then renamed, so that a killed run leaves the previous checkpoint intact
+  bool written = true;
+  {
+    std::ofstream file(tempFilePath);
+    file << "run " << runKey << "\n";
+    file << "position " << position << "\n";
+    file << "vars " << ddVarToCnfVarMap.size();
+    for (Int cnfVar : ddVarToCnfVarMap) {
+      file << " " << cnfVar;
+    }
+    file << "\n";
+    file << "loaded " << loadedPositions.size(); // of cached subtrees, whose descendants have no DDs on stack
+    for (Int loadedPosition : loadedPositions) {
+      file << " " << loadedPosition;
+    }
+    file << "\n";
+    file << "dds " << childDdStack.size() << "\n";
+    for (const Dd& dd : childDdStack) {
+      if (!dd.writeNodes(file, ddVarToCnfVarMap)) {
+        written = false;
+        break;
+      }
+    }
+    written = written && file.good();
+  }
+  latestWritePoint = util::getTimePoint(); // also after failure, so that it is not retried at every node
+  if (!written) {
+    std::filesystem::remove(tempFilePath);
+    printLine("WARNING: skipped checkpoint at post-order position " + to_string(position));
+    return;
+  }
+  std::filesystem::rename(tempFilePath, filePath);
+  util::Trace::addSpan("checkpoint", writeStartPoint, latestWritePoint, {{"position", to_string(position)}, {"dds", to_string(childDdStack.size())}});
+  writtenCount++;
+  printLine("wrote checkpoint at post-order position " + to_string(position) + " in " + to_string(util::getDuration(writeStartPoint)) + " seconds");
+}
+
+vector<dpve::Int> Checkpoint::readVarOrder() {
+  file.open(filePath);
+  if (!file) {
+    throw util::MyError("unable to open checkpoint file ", filePath);
+  }
+  string line;
+  if (!getline(file, line) || line != "run " + runKey) { // else stacked DDs would silently give a wrong count
+    throw util::MyError("checkpoint file ", filePath, " was written with other weights or options (", line, " instead of run ", runKey, ")");
+  }
+  string word;
+  Int varCount;
+  if (!(file >> word >> position) || word != "position" || !(file >> word >> varCount) || word != "vars") {
+    throw util::MyError("malformed checkpoint file ", filePath);
+  }
+  vector<Int> ddVarToCnfVarMap(varCount);
+  for (Int& cnfVar : ddVarToCnfVarMap) {
+    if (!(file >> cnfVar)) {
+      throw util::MyError("malformed checkpoint file ", filePath);
+    }
+  }
+  return ddVarToCnfVarMap;
+}
+
+dpve::Int Checkpoint::readDds(const vector<Int>& cnfVarToDdVarMap, vector<Dd>& childDdStack, Set<Int>& loadedPositions) {
+  string word;
+  Int loadedCount;
+  if (!(file >> word >> loadedCount) || word != "loaded") {
+    throw util::MyError("malformed checkpoint file ", filePath);
+  }
+  for (Int i = 0; i < loadedCount; i++) {
+    Int loadedPosition;
+    if (!(file >> loadedPosition)) {
+      throw util::MyError("malformed checkpoint file ", filePath);
+    }
+    loadedPositions.insert(loadedPosition);
+  }
+  Int ddCount;
+  if (!(file >> word >> ddCount) || word != "dds") {
+    throw util::MyError("malformed checkpoint file ", filePath);
+  }
+  for (Int i = 0; i < ddCount; i++) {
+    childDdStack.push_back(Dd::readNodes(file, cnfVarToDdVarMap));
+  }
+  file.close();
+  resuming = false;
+  printLine("resuming from checkpoint at post-order position " + to_string(position));
+  return position;
+}
+
+void Checkpoint::remove() {
+  std::filesystem::remove(filePath);
+}
+
+Checkpoint::Checkpoint(const string& checkpointDir, const Cnf& cnf, const string& runKey, Float intervalSeconds, bool resuming):
+  intervalSeconds(intervalSeconds), resuming(resuming), filePath((std::filesystem::path(checkpointDir) / (cnf.getHash() + ".ck")).string()), runKey(runKey) {
+  std::filesystem::create_directories(checkpointDir);
+  if (!resuming) {
+    std::filesystem::remove(filePath); // of an earlier run, possibly with another join tree
+  }
+  latestWritePoint = util::getTimePoint();
+}
+
+/* class Monitor ============================================================ */
+
+dpve::Float Monitor::getRssMegabytes() {
+  std::ifstream statm("/proc/self/statm");
+  Int pageCount = 0;
+  statm >> pageCount >> pageCount; // total size, then resident size
+  return pageCount * (Float) sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+void Monitor::sample() {
+  TimePoint startPoint = util::getTimePoint();
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopCondition.wait_for(lock, std::chrono::duration<Float>(intervalSeconds), [this] { return stopping; })) {
+    Float rss = getRssMegabytes();
+    Action action = NO_ACTION;
+    if (memLimitMegabytes > 0) {
+      Float fraction = rss / memLimitMegabytes;
+      action = fraction >= 1 ? ABORT_ACTION : fraction >= 0.9 ? REORDER_ACTION : fraction >= 0.8 ? GC_ACTION : NO_ACTION;
+    }
+    bool stuck = action == ABORT_ACTION && pendingAction == ABORT_ACTION; // executor has not reached a safe point since previous sample
+
+    std::ostringstream line;
+    line << "c o status seconds=" << std::fixed << std::setprecision(1) << util::getDuration(startPoint) << " rssMegabytes=" << rss;
+    line << " tableNodes=" << tableNodeCount << std::setprecision(3) << " tableFill=" << (tableSlotCount > 0 ? (double) tableNodeCount / tableSlotCount : 0.0);
+    if (cacheHitRate >= 0) {
+      line << " cacheHitRate=" << cacheHitRate;
+    }
+    line << " joinNodes=" << processedJoinNodes << "/" << joinNodeCount;
+    const vector<string> ACTION_NAMES = {"none", "gc", "reorder", "abort"};
+    line << " action=" << (stuck ? "exit" : ACTION_NAMES.at(action)) << "\n";
+    if (statusFile.is_open()) {
+      statusFile << line.str() << std::flush;
+    }
+    else {
+      std::cout << line.str(); // in one write, so that it is not split by rows of executor thread
+    }
+    if (stuck) { // e.g. in one huge product: exits before being killed without diagnostics
+      exitWithReport(processedJoinNodes + 1);
+    }
+
+    if (action > pendingAction) {
+      pendingAction = action;
+    }
+    statsRequested = true;
+  }
+}
+
+void Monitor::exitWithReport(Int joinNode) {
+  printRow("aborted", "memory limit of " + to_string(memLimitMegabytes) + " MB reached during join node " + to_string(joinNode)); // as after AbortException
+  util::Trace::close();
+  if (util::PerfCounters::isOpen()) {
+    util::PerfCounters::printRows(); // of finished scopes
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  io::Report::add("memory", "peakRssMegabytes", usage.ru_maxrss / 1024.0);
+  try {
+    io::Report::close(); // under the lock that executor thread takes to add fields
+  }
+  catch (const util::MyError&) {} // already printed
+  std::_Exit(1); // executor thread cannot be unwound from inside a DD operation
+}
+
+void Monitor::atSafePoint(Int processedJoinNodes, Int joinNodeCount) {
+  this->processedJoinNodes = processedJoinNodes;
+  this->joinNodeCount = joinNodeCount;
+  if (statsRequested.exchange(false)) {
+    size_t nodeCount, slotCount;
+    Float hitRate;
+    Dd::readTableStats(nodeCount, slotCount, hitRate);
+    tableNodeCount = nodeCount;
+    tableSlotCount = slotCount;
+    cacheHitRate = hitRate;
+  }
+  switch (pendingAction.exchange(NO_ACTION)) {
+    case GC_ACTION:
+      printLine("memory governor: collecting garbage");
+      Dd::collectGarbage();
+      break;
+    case REORDER_ACTION:
+      printLine("memory governor: reordering");
+      if (!Dd::forceReorder()) {
+        Dd::collectGarbage();
+      }
+      break;
+    case ABORT_ACTION:
+      throw util::AbortException("memory limit of " + to_string(memLimitMegabytes) + " MB reached after " + to_string(processedJoinNodes) + " join nodes");
+  }
+}
+
+Monitor::Monitor(Float intervalSeconds, const string& statusFilePath, Float memLimitMegabytes):
+  intervalSeconds(intervalSeconds), memLimitMegabytes(memLimitMegabytes) {
+  if (!statusFilePath.empty()) {
+    statusFile.open(statusFilePath, std::ios::app);
+    if (!statusFile) {
+      throw util::MyError("unable to open status file ", statusFilePath);
+    }
+  }
+  sampler = std::thread(&Monitor::sample, this);
+}
+
+Monitor::~Monitor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  stopCondition.notify_one();
+  sampler.join();
+}
+
 /* class Executor =========================================================== */
 
-Dd Executor::solveSubtree(const JoinNode* joinNode, const PruneMaxParams& pmParams, const Assignment& assignment ) {
-  // cout<<"Starting visit of joinNode number "<<joinNode->nodeIndex+1<<"\n";
-  if (joinNode->isTerminal()) {
-    TimePoint terminalStartPoint = util::getTimePoint();
+vector<uint64_t> Executor::getSubtreeHashes(const JoinTree& joinTree) const {
+  auto getNumberString = [](const Number& n) {
+    if (Number::multiplePrecision) {
+      return n.quotient.get_str();
+    }
+    std::ostringstream stream;
+    stream << std::hexfloat << n.fraction; // exact
+    return stream.str();
+  };
 
-    joinNodesProcessed ++;
-    if (((joinNodesProcessed-1)%(std::max((JoinNode::nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(JoinNode::nodeCount)+":"+to_string(util::getDuration(executorStartPoint))+" ");
-    if (satFilter>0) {
-      return (((Dd*)joinNode->dd)->getAdd());
-    } else{
-      Map<Int, pair<Int,Int>> ddVarSignAndAsnmts;
-      const Clause& c = cnf.clauses.at(joinNode->nodeIndex);
-      for (auto cnfLit:c){
-        Int ddVar = cnfVarToDdVarMap.at(abs(cnfLit));
-        //NOTE: ddVars are 0-indexed so can't use sign to indicate polarity
-        auto it = assignment.find(abs(cnfLit));
-        if (it != assignment.end()) { // variable has assigned value in assignment
-          ddVarSignAndAsnmts[ddVar] = {cnfLit>0,it->second?1:-1}; //if asnmt is true then positive else negative
-        } else{
-          ddVarSignAndAsnmts[ddVar] = {cnfLit>0,0}; // unassigned then zero
-        }
+  vector<uint64_t> nodeHashes(joinTree.declaredNodeCount);
+  vector<Int> sortedLiterals;
+  vector<uint64_t> childHashes;
+  for (Int node : joinTree.postOrder) {
+    uint64_t hash = util::HASH_SEED;
+    util::mixHash(hash, joinTree.isTerminal(node));
+    if (joinTree.isTerminal(node)) {
+      Clause clause = cnf.clauses.at(node);
+      sortedLiterals.assign(clause.begin(), clause.end());
+      std::sort(sortedLiterals.begin(), sortedLiterals.end());
+      util::mixHash(hash, clause.xorFlag);
+      util::mixHash(hash, sortedLiterals.size());
+      for (Int literal : sortedLiterals) {
+        util::mixHash(hash, literal);
+      }
+    }
+    else {
+      childHashes.clear();
+      for (Int child : joinTree.getChildren(node)) {
+        childHashes.push_back(nodeHashes[child]);
+      }
+      std::sort(childHashes.begin(), childHashes.end()); // so that child order does not matter
+      util::mixHash(hash, childHashes.size());
+      for (uint64_t childHash : childHashes) {
+        util::mixHash(hash, childHash);
       }
-      return Dd::getClauseDd(ddVarSignAndAsnmts,c.xorFlag);
-    }  
+      for (Int var : joinTree.getProjectionVars(node)) { // ascending
+        util::mixHash(hash, var);
+        util::mixHash(hash, additiveFlags[var]);
+        util::mixHash(hash, getNumberString(positiveWeights[var]));
+        util::mixHash(hash, getNumberString(negativeWeights[var]));
+      }
+    }
+    nodeHashes[node] = hash;
+  }
+  return nodeHashes;
+}
+
+Dd Executor::solveTree(const JoinTree& joinTree, const PruneMaxParams& pmParams, const Assignment& assignment ) {
+  Int nodeCount = joinTree.declaredNodeCount;
+  for (const auto& [cnfVar, val] : assignment) {
+    varAsmts.at(cnfVar) = val ? 1 : -1;
   }
 
-  Dd dd = satFilter>0? ((Dd*)joinNode->dd)->getAdd() : Dd::getOneDd();
-  if (satFilter>0){
-    *(Dd*)(((JoinNode*) joinNode)->dd) = Dd::getOneBdd(); //once you get the ADD no need for the BDD
+  vector<Dd> childDdStack; // DDs of solved nodes whose parents are unsolved, in post order
+  bool checkpointing = checkpoint != nullptr && assignment.empty(); // checkpointed DDs have no assigned vars
+  bool tracing = util::Trace::isOpen();
+  Int startPosition = 0;
+  Set<Int> resumedLoadedPositions; // of subtrees loaded by checkpointed run
+  if (checkpointing && checkpoint->resuming) {
+    startPosition = checkpoint->readDds(cnfVarToDdVarMap, childDdStack, resumedLoadedPositions);
+    joinNodesProcessed += startPosition;
   }
 
-  if (joinPriority == FCFS){
-    for (JoinNode* child : joinNode->children) {
-      dd = dd.getProduct(solveSubtree(child, pmParams, assignment));
+  bool caching = subtreeCache != nullptr && assignment.empty(); // cached DDs have no assigned vars
+  if (!caching && !resumedLoadedPositions.empty()) {
+    throw util::MyError("checkpointed run loaded cached subtrees; resume with same diagram cache directory");
+  }
+  vector<uint64_t> nodeHashes;
+  vector<bool> loadedNodes; // roots of cached subtrees that are not inside other cached subtrees
+  vector<bool> skippedNodes; // inside loaded subtrees
+  vector<Int> loadedPositions; // of loaded nodes, for checkpoints
+  if (caching) {
+    nodeHashes = getSubtreeHashes(joinTree);
+    vector<Int> positions(nodeCount); // node |-> post-order position
+    vector<Int> firstPositions(nodeCount); // node |-> post-order position of first node in its subtree
+    for (Int position = 0; position < joinTree.postOrder.size(); position++) {
+      Int node = joinTree.postOrder[position];
+      auto children = joinTree.getChildren(node);
+      positions[node] = position;
+      firstPositions[node] = children.empty() ? position : firstPositions[children.front()];
     }
-  } else{
-    vector<Dd> childDdList;
-    for (JoinNode* child : joinNode->children) {
-      childDdList.push_back(solveSubtree(child, pmParams, assignment));
+    loadedNodes.assign(nodeCount, false);
+    skippedNodes.assign(nodeCount, false);
+    for (auto it = joinTree.postOrder.rbegin(); it != joinTree.postOrder.rend(); it++) { // parents first
+      Int node = *it;
+      if (!skippedNodes[node] && !joinTree.isTerminal(node)) {
+        if (firstPositions[node] < startPosition) { // resumed stack is as checkpointed run left it, whatever the cache holds now
+          loadedNodes[node] = resumedLoadedPositions.contains(positions[node]);
+        }
+        else {
+          loadedNodes[node] = subtreeCache->hasDd(nodeHashes[node]);
+        }
+      }
+      if (loadedNodes[node]) {
+        loadedPositions.push_back(positions[node]);
+      }
+      if (skippedNodes[node] || loadedNodes[node]) {
+        for (Int child : joinTree.getChildren(node)) {
+          skippedNodes[child] = true;
+        }
+      }
     }
-    
-    //Following call considers reordering if enabled.
-    //Has internal checks to decide when to reorder
-    // Dd::manualReorder(levelMaps);
-    /*
-    if (joinNodesProcessed>JoinNode::nodeCount*reOrdThresh){
-      reOrdThresh += 0.05;
-      
-      if(voInd == 0){
-        assert (ratio == 0);
-        printLine("No better order found. Order is unchanged!");
+  }
+  vector<TimePoint> childStartStack; // start times of subtrees on `childDdStack`, for caching expensive ones
+  if (caching) {
+    childStartStack.assign(childDdStack.size(), util::getTimePoint()); // of resumed subtrees, whose earlier run time is unknown
+  }
+  for (Int position = startPosition; position < joinTree.postOrder.size(); position++) {
+    Int node = joinTree.postOrder[position];
+    if (checkpointing && checkpoint->isDue()) {
+      checkpoint->write(position, childDdStack, ddVarToCnfVarMap, loadedPositions);
+    }
+    if (monitor != nullptr) {
+      monitor->atSafePoint(joinNodesProcessed, nodeCount);
+    }
+    // cout<<"Starting visit of joinNode number "<<node+1<<"\n";
+    if (caching) {
+      if (skippedNodes[node]) {
+        continue;
+      }
+      childStartStack.push_back(util::getTimePoint()); // replaced by start of first child for nonterminal
+      if (loadedNodes[node]) {
+        childDdStack.push_back(subtreeCache->loadDd(nodeHashes[node], cnfVarToDdVarMap));
+        if (tracing) {
+          util::Trace::addSpan("cached subtree " + to_string(node + 1), childStartStack.back(), util::getTimePoint(), {{"nodes", to_string(childDdStack.back().getNodeCount())}});
+        }
+        continue;
+      }
+    }
+    if (joinTree.isTerminal(node)) {
+      joinNodesProcessed ++;
+      if (((joinNodesProcessed-1)%(std::max((nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(nodeCount)+":"+to_string(util::getDuration(executorStartPoint))+" ");
+      if (satFilter>0) {
+        childDdStack.push_back(nodeBdds.at(node).getAdd());
       } else{
-        printLine("Better order found: "+CNF_VAR_ORDER_HEURISTICS.at(abs(voInd))+(voInd<0?" reversed": " unreverseed")+
-          " with size reduction ratio: "+to_string(ratio));
+        const Clause& c = cnf.clauses.at(node);
+        clauseLiterals.clear();
+        for (auto cnfLit:c){
+          Int cnfVar = abs(cnfLit);
+          //NOTE: ddVars are 0-indexed so can't use sign to indicate polarity
+          clauseLiterals.push_back({cnfVarToDdVarMap[cnfVar], cnfLit>0, varAsmts[cnfVar]});
+        }
+        childDdStack.push_back(Dd::getClauseDd(clauseLiterals,c.xorFlag));
       }
+      continue;
+    }
+
+    TimePoint nodeStartPoint = util::getTimePoint();
+    Dd dd = satFilter>0? nodeBdds.at(node).getAdd() : Dd::getOneDd();
+    if (satFilter>0){
+      nodeBdds.at(node) = Dd::getOneBdd(); //once you get the ADD no need for the BDD
+    }
+
+    auto firstChildDd = childDdStack.end() - joinTree.getChildren(node).size();
+    vector<Dd> childDdList(firstChildDd, childDdStack.end());
+    childDdStack.erase(firstChildDd, childDdStack.end());
+    if (caching) {
+      auto firstChildStart = childStartStack.end() - 1 - joinTree.getChildren(node).size(); // or start of this node if it has no children
+      TimePoint subtreeStartPoint = *firstChildStart;
+      childStartStack.erase(firstChildStart, childStartStack.end());
+      childStartStack.push_back(subtreeStartPoint);
     }
-    */
 
-    if (joinPriority == ARBITRARY_PAIR) { // arbitrarily multiplies child decision diagrams
+    string childNodeCounts; // JSON array, for trace
+    if (tracing) {
+      for (const Dd& childDd : childDdList) {
+        childNodeCounts += (childNodeCounts.empty() ? "[" : ",") + to_string(childDd.getNodeCount());
+      }
+      childNodeCounts += childNodeCounts.empty() ? "[]" : "]";
+    }
+
+    //Following call considers reordering if enabled.
+    //Has internal checks to decide when to reorder
+    // Dd::manualReorder(levelMaps);
+
+    if (joinPriority == FCFS || joinPriority == ARBITRARY_PAIR) { // multiplies child decision diagrams in order
       for (Dd childDd : childDdList) {
         dd = dd.getProduct(childDd);
       }
@@ -241,39 +633,72 @@ Dd Executor::solveSubtree(const JoinNode* joinNode, const PruneMaxParams& pmPara
       }
       dd = childDdQueue.top();
     }
-  }
-  // Map<Int,tuple<Float,Float,bool, Int>> ddVarWts;
-  Map<Int,tuple<Number,Number,bool, Int>> ddVarWts;
-  for (auto& pVar: joinNode->projectionVars){
-    Int ddVar = cnfVarToDdVarMap.at(pVar);
-    Number posWt = cnf.literalWeights.at(pVar);//.fraction;
-    Number negWt = cnf.literalWeights.at(-pVar);//.fraction;
-    bool additiveFlag = cnf.outerVars.contains(pVar);
-    if (existRandom) {
-      additiveFlag = !additiveFlag;
+    TimePoint productEndPoint = util::getTimePoint();
+    ddVarWts.clear();
+    for (Int pVar: joinTree.getProjectionVars(node)){
+      ddVarWts.push_back({cnfVarToDdVarMap[pVar], &positiveWeights[pVar], &negativeWeights[pVar], additiveFlags[pVar], varAsmts[pVar]});
     }
-    Int asmt;
-    auto it = assignment.find(pVar);
-    if (it != assignment.end()) { // literal has assigned value
-      asmt = it->second?1:-1;
-    }else{ //unassigned
-      asmt = 0;
+    dd = dd.getAbstraction(ddVarWts,pmParams.logBound,maximizationStack,pmParams.maximizerFormat,pmParams.substitutionMaximization,verboseSolving);
+    if (dd.isZero()){
+      printLine("WARNING: Returned Dd after abstraction is zero at joinNode number "+to_string(joinNodesProcessed));
     }
-    ddVarWts[ddVar]={posWt,negWt,additiveFlag,asmt};
-  }
-  dd = dd.getAbstraction(ddVarWts,pmParams.logBound,maximizationStack,pmParams.maximizerFormat,pmParams.substitutionMaximization,verboseSolving);
-  if (dd.isZero()){
-    printLine("WARNING: Returned Dd after abstraction is zero at joinNode number "+to_string(joinNodesProcessed));
+    if (tracing) {
+      TimePoint nodeEndPoint = util::getTimePoint();
+      util::Trace::addSpan("node " + to_string(node + 1), nodeStartPoint, nodeEndPoint, {
+        {"childNodes", childNodeCounts},
+        {"projectionVars", to_string(ddVarWts.size())},
+        {"productSeconds", to_string(std::chrono::duration<double>(productEndPoint - nodeStartPoint).count())},
+        {"abstractionSeconds", to_string(std::chrono::duration<double>(nodeEndPoint - productEndPoint).count())},
+        {"nodes", to_string(dd.getNodeCount())},
+        {"leaves", to_string(dd.getLeafCount())}
+      }); // 1-indexing, as in join tree files
+      util::Trace::addSpan("product", nodeStartPoint, productEndPoint);
+      util::Trace::addSpan("abstraction", productEndPoint, nodeEndPoint);
+    }
+    if (caching && util::getDuration(childStartStack.back()) >= subtreeCache->minSeconds) {
+      subtreeCache->storeDd(nodeHashes[node], dd, ddVarToCnfVarMap);
+    }
+    childDdStack.push_back(dd);
+
+    joinNodesProcessed ++;
+    if (((joinNodesProcessed-1)%(std::max((nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(nodeCount)+":"+to_string(util::getDuration(executorStartPoint))+" ");
   }
-  const Set<Int> sup = dd.getSupport();
-  for (auto& cnfVar:joinNode->projectionVars){
-    Int ddVar = cnfVarToDdVarMap.at(cnfVar);
-//    assert (!sup.contains(ddVar));
+  for (const auto& [cnfVar, val] : assignment) {
+    varAsmts.at(cnfVar) = 0;
   }
+  return childDdStack.back();
+}
 
-  joinNodesProcessed ++;
-  if (((joinNodesProcessed-1)%(std::max((JoinNode::nodeCount/10),1LL)))==1) printLine(to_string(joinNodesProcessed)+"/"+to_string(JoinNode::nodeCount)+":"+to_string(util::getDuration(executorStartPoint))+" ");
-  return dd;
+size_t Executor::getTrialNodeCount(const JoinTree& joinTree, Int firstPosition, Int endPosition, size_t nodeCountLimit) {
+  size_t nodeCount = 0;
+  vector<pair<Int, Dd>> trialMaximizationStack; // unused, since nothing is maximized
+  vector<Dd> childDdStack;
+  for (Int position = firstPosition; position < endPosition && nodeCount < nodeCountLimit; position++) {
+    Int node = joinTree.postOrder[position];
+    if (joinTree.isTerminal(node)) {
+      const Clause& c = cnf.clauses.at(node);
+      clauseLiterals.clear();
+      for (auto cnfLit:c){
+        Int cnfVar = abs(cnfLit);
+        clauseLiterals.push_back({cnfVarToDdVarMap[cnfVar], cnfLit>0, 0});
+      }
+      childDdStack.push_back(Dd::getClauseDd(clauseLiterals,c.xorFlag));
+      continue;
+    }
+    Dd dd = Dd::getOneDd();
+    auto firstChildDd = childDdStack.end() - joinTree.getChildren(node).size();
+    for (auto it = firstChildDd; it != childDdStack.end(); it++) { // in order, whatever joinPriority is, so that trials are comparable
+      dd = dd.getProduct(*it);
+    }
+    childDdStack.erase(firstChildDd, childDdStack.end());
+    nodeCount += dd.getNodeCount(); // before abstraction, when DD is biggest
+    ddVarWts.clear();
+    for (Int pVar: joinTree.getProjectionVars(node)){
+      ddVarWts.push_back({cnfVarToDdVarMap[pVar], &positiveWeights[pVar], &negativeWeights[pVar], additiveFlags[pVar], 0});
+    }
+    childDdStack.push_back(dd.getAbstraction(ddVarWts, -INF, trialMaximizationStack, false, false, 0));
+  }
+  return nodeCount;
 }
 
 Assignment Executor::getMaximizer(Int declaredVarCount) {
@@ -294,17 +719,21 @@ Assignment Executor::getMaximizer(Int declaredVarCount) {
   return cnfVarAssignment;
 }
 
+string Dpve::getDdMode() const {
+  return DD_PACKAGES.at(p.ddPackage) + (p.logCounting ? "_LOG" : "") + (p.multiplePrecision ? "_MP" : "");
+}
+
 void Dpve::setLogBound() {
   if (p.pmParams.logBound > -INF) {} // LOG_BOUND_OPTION
   else if (!p.pmParams.thresholdModel.empty()) { // THRESHOLD_MODEL_OPTION
-    p.pmParams.logBound = e->solveSubtree(joinRoot,p.pmParams, Assignment(p.pmParams.thresholdModel)).extractConst().fraction;
+    p.pmParams.logBound = e->solveTree(*joinTree,p.pmParams, Assignment(p.pmParams.thresholdModel)).extractConst().fraction;
     printRow("logBound", p.pmParams.logBound);
   }
   else if (p.pmParams.satSolverPruning) { // SAT_SOLVER_PRUNING
     SatSolver satSolver(p.cnf);
     satSolver.checkSat(true);
     Assignment model = satSolver.getModel();
-    p.pmParams.logBound = e->solveSubtree(joinRoot,p.pmParams, model).extractConst().fraction;
+    p.pmParams.logBound = e->solveTree(*joinTree,p.pmParams, model).extractConst().fraction;
     printRow("logBound", p.pmParams.logBound);
     printLine(model.getShortFormat(p.cnf.declaredVarCount));
   }
@@ -351,26 +780,44 @@ Number Dpve::getAdjustedSolution(const Number &apparentSolution) {
 }
 
 Number Dpve::getMaximizerValue(const Assignment& maximizer) {
-  Dd dd = e->solveSubtree(joinRoot, p.pmParams, maximizer);
+  Dd dd = e->solveTree(*joinTree, p.pmParams, maximizer);
   Number solution = dd.extractConst();
   return getAdjustedSolution(solution);
 }
 
-Executor::Executor(const Cnf& cnf, const Map<Int, Int>& cnfVarToDdVarMap, const vector<Int>& ddVarToCnfVarMap,
-      const bool existRandom, const string joinPriority, const Int satFilter, const Int verboseSolving, const Int verboseProfiling,
-      const Map<Int, vector<Int>> levelMaps_): 
+Executor::Executor(const Cnf& cnf, const vector<Int>& cnfVarToDdVarMap, const vector<Int>& ddVarToCnfVarMap,
+      const bool existRandom, const string joinPriority, const Int satFilter, vector<Dd>& nodeBdds, const Int verboseSolving, const Int verboseProfiling,
+      const Map<Int, vector<Int>> levelMaps_, SubtreeCache* subtreeCache, Checkpoint* checkpoint,
+      Monitor* monitor): 
     cnf(cnf),
     cnfVarToDdVarMap(cnfVarToDdVarMap),
     ddVarToCnfVarMap(ddVarToCnfVarMap),
     existRandom(existRandom),
     joinPriority(joinPriority),
     satFilter(satFilter),
+    nodeBdds(nodeBdds),
     verboseSolving(verboseSolving),
     verboseProfiling(verboseProfiling),
-    levelMaps(levelMaps_)
+    levelMaps(levelMaps_),
+    subtreeCache(subtreeCache),
+    checkpoint(checkpoint),
+    monitor(monitor)
     {
       joinNodesProcessed = 0;
       executorStartPoint = util::getTimePoint();
+
+      Int varCount = cnf.declaredVarCount;
+      positiveWeights.reserve(varCount + 1);
+      negativeWeights.reserve(varCount + 1);
+      positiveWeights.push_back(Number("1")); // for var 0, which is unused
+      negativeWeights.push_back(Number("1"));
+      additiveFlags.assign(varCount + 1, false);
+      for (Int cnfVar = 1; cnfVar <= varCount; cnfVar++) {
+        positiveWeights.push_back(cnf.literalWeights.at(cnfVar));
+        negativeWeights.push_back(cnf.literalWeights.at(-cnfVar));
+        additiveFlags[cnfVar] = cnf.outerVars.contains(cnfVar) != existRandom;
+      }
+      varAsmts.assign(varCount + 1, 0);
     }
 
 void Dpve::reorder(){ 
@@ -381,10 +828,11 @@ Dpve::Dpve(const io::InputParams& p_):p(p_){
   //construct join tree
   //compute var order
   Dd::init(p.ddPackage,p.cnf.apparentVars.size(),p.logCounting,p.atomicAbstract, p.weightedCounting, p.multiplePrecision,p.tableRatio,p.initRatio,
-    p.threadCount,p.maxMem,p.dynVarOrdering,0);
+    p.threadCount,p.maxMem,p.dynVarOrdering,0,p.reorderBudget);
 }
 
 Dpve::~Dpve(){
+  nodeBdds.clear(); // before DD manager stops
   Dd::stop();
   if(p.satFilter>0){
     delete s;
@@ -392,16 +840,209 @@ Dpve::~Dpve(){
   if(p.satFilter!=1){
     delete e;
   }
+  delete subtreeCache;
+  delete checkpoint;
+  delete monitor;
 }
 
-pair<Number, Assignment> Dpve::computeSolution(){
+void Dpve::setJoinTree(){
   JoinTreeProcessor::toolStartPoint = p.toolStartPoint;
   JoinTreeProcessor::verboseJoinTree = p.verboseJoinTree;
-  JoinTreeProcessor joinTreeProcessor(p.plannerWaitDuration, p.cnf);
+  if (checkpoint != nullptr && checkpoint->resuming) { // checkpointed DDs belong to join tree of checkpointed run
+    JoinTreeCache checkpointTreeCache(p.checkpointDir, p.cnf);
+    if (!checkpointTreeCache.hasJoinTree()) {
+      throw util::MyError("no join tree to resume from: ", checkpointTreeCache.filePath);
+    }
+    joinTree = checkpointTreeCache.loadJoinTree(p.cnf);
+    if (p.clusteringHeuristic.empty()) {
+      std::cout << "c using checkpointed join tree; killing planner on stdin\n";
+      JoinTreeProcessor::killPlannerOnStdin();
+    }
+    return;
+  }
+
+  JoinTreeCache joinTreeCache(p.joinTreeCacheDir, p.cnf);
+  if (joinTreeCache.hasJoinTree()) {
+    joinTree = joinTreeCache.loadJoinTree(p.cnf);
+    if (p.clusteringHeuristic.empty()) {
+      std::cout << "c using cached join tree; killing planner on stdin\n";
+      JoinTreeProcessor::killPlannerOnStdin(); // else it keeps a core busy until dmc exits
+    }
+    storeJoinTree(JoinTreeCache("", p.cnf)); // only beside checkpoint
+    return;
+  }
+
+  if (p.clusteringHeuristic.empty()) { // join tree is piped from planner process
+    JoinTreeProcessor joinTreeProcessor(p.plannerWaitDuration, p.cnf);
+    joinTree = joinTreeProcessor.getJoinTree();
+    storeJoinTree(joinTreeCache);
+    return;
+  }
+
+  std::cout << "c planning join tree in process...\n";
+  Planner* planner = Planner::newPlanner(p.cnf, p.clusteringHeuristic, p.clusterVarOrderHeuristic, p.verboseSolving);
+  JoinTree* plannedTree = new JoinTree(planner->getJoinRoot(), p.cnf.declaredVarCount, planner->terminalCount, planner->nodeCount, p.cnf);
+  plannedTree->width = planner->width;
+  plannedTree->plannerDuration = planner->plannerDuration;
+  joinTree = plannedTree;
+  printRow("joinTreeWidth", joinTree->width);
+  printRow("plannerSeconds", planner->plannerDuration);
+  if (p.verboseJoinTree >= 1) {
+    std::cout << io::DASH_LINE;
+    planner->printJoinTree("c ");
+    std::cout << io::DASH_LINE;
+  }
+  delete planner;
+  storeJoinTree(joinTreeCache);
+}
+
+void Dpve::storeJoinTree(const JoinTreeCache& joinTreeCache) const {
+  joinTreeCache.storeJoinTree(*joinTree);
+  if (checkpoint != nullptr) {
+    JoinTreeCache checkpointTreeCache(p.checkpointDir, p.cnf);
+    std::filesystem::remove(checkpointTreeCache.filePath); // possibly wider, but its checkpoint is gone
+    checkpointTreeCache.storeJoinTree(*joinTree);
+  }
+}
+
+vector<vector<dpve::Int>> Dpve::getVarOrders(const vector<Int>& heuristics) const {
+  vector<vector<Int>> varOrders(heuristics.size()); // independent and read-only on CNF and join tree, so computed concurrently
+  std::atomic<Int> nextHeuristicIndex = 0;
+  auto computeRemaining = [this, &heuristics, &varOrders, &nextHeuristicIndex]() {
+    for (Int i = nextHeuristicIndex++; i < heuristics.size(); i = nextHeuristicIndex++) {
+      varOrders[i] = joinTree->getVarOrder(heuristics.at(i), p.cnf);
+    }
+  };
+  vector<std::thread> threads;
+  for (Int i = 1; i < std::min<Int>(p.threadCount, heuristics.size()); i++) {
+    threads.emplace_back(computeRemaining);
+  }
+  computeRemaining();
+  for (std::thread& t : threads) {
+    t.join();
+  }
+  return varOrders;
+}
+
+vector<pair<dpve::Int, dpve::Int>> Dpve::getSampledSubtrees(Int sampleCount) const {
+  vector<Int> clauseCounts(joinTree->declaredNodeCount, 0); // node |-> terminals in subtree
+  vector<Int> nodeCounts(joinTree->declaredNodeCount, 1); // node |-> nodes in subtree, which are contiguous in post order
+  for (Int node : joinTree->postOrder) {
+    if (joinTree->isTerminal(node)) {
+      clauseCounts[node] = 1;
+    }
+    for (Int child : joinTree->getChildren(node)) {
+      clauseCounts[node] += clauseCounts[child];
+      nodeCounts[node] += nodeCounts[child];
+    }
+  }
+
+  Int maxClauseCount = max(p.cnf.clauses.size() / (2 * sampleCount), (Int) 2); // so that trials take a fraction of the full run
+  vector<pair<Int, Int>> subtrees; // (clause count, node), of biggest nonterminal subtrees under cap
+  Int root = joinTree->getRoot();
+  if (clauseCounts[root] <= maxClauseCount) {
+    subtrees.push_back({clauseCounts[root], root});
+  }
+  for (Int node : joinTree->postOrder) {
+    if (clauseCounts[node] <= maxClauseCount) {
+      continue;
+    }
+    for (Int child : joinTree->getChildren(node)) {
+      if (!joinTree->isTerminal(child) && clauseCounts[child] <= maxClauseCount) {
+        subtrees.push_back({clauseCounts[child], child});
+      }
+    }
+  }
+  std::sort(subtrees.begin(), subtrees.end(), std::greater<pair<Int, Int>>());
+  subtrees.resize(std::min<Int>(subtrees.size(), sampleCount));
+
+  vector<Int> positions(joinTree->declaredNodeCount, -1); // node |-> index in post order
+  for (Int position = 0; position < joinTree->postOrder.size(); position++) {
+    positions[joinTree->postOrder[position]] = position;
+  }
+  vector<pair<Int, Int>> positionRanges;
+  for (auto [clauseCount, node] : subtrees) {
+    positionRanges.push_back({positions[node] - nodeCounts[node] + 1, positions[node] + 1});
+  }
+  return positionRanges;
+}
+
+vector<dpve::Int> Dpve::getAutotunedVarOrder() {
+  TimePoint autotuneStartPoint = util::getTimePoint();
+  auto getName = [](Int v) {
+    return (v < 0 ? "INVERSE_" : "") + (CNF_VAR_ORDER_HEURISTICS.contains(abs(v)) ? CNF_VAR_ORDER_HEURISTICS.at(abs(v)) : JOIN_TREE_VAR_ORDER_HEURISTICS.at(abs(v)));
+  };
+  vector<Int> heuristics{p.ddVarOrderHeuristic};
+  for (const auto& [v, s] : CNF_VAR_ORDER_HEURISTICS) {
+    if (v != RANDOM_HEURISTIC && v != p.ddVarOrderHeuristic) {
+      heuristics.push_back(v);
+    }
+  }
+  for (const auto& [v, s] : JOIN_TREE_VAR_ORDER_HEURISTICS) {
+    if (v != p.ddVarOrderHeuristic) {
+      heuristics.push_back(v);
+    }
+  }
+  vector<vector<Int>> varOrders = getVarOrders(heuristics);
+  vector<pair<Int, Int>> positionRanges = getSampledSubtrees(p.autotuneSubtrees);
+
+  Int bestIndex = 0;
+  size_t bestNodeCount = SIZE_MAX;
+  for (Int i = 0; i < heuristics.size(); i++) {
+    vector<Int>& trialDdVarToCnfVarMap = varOrders.at(i);
+    vector<Int> trialCnfVarToDdVarMap(p.cnf.declaredVarCount + 1, -1);
+    for (Int ddVar = 0; ddVar < trialDdVarToCnfVarMap.size(); ddVar++) {
+      trialCnfVarToDdVarMap[trialDdVarToCnfVarMap.at(ddVar)] = ddVar;
+    }
+    size_t nodeCount = 0;
+    {
+      vector<Dd> trialNodeBdds;
+      Executor trialExecutor(p.cnf, trialCnfVarToDdVarMap, trialDdVarToCnfVarMap, p.existRandom, p.joinPriority, 0, trialNodeBdds, 0, 0);
+      for (auto [firstPosition, endPosition] : positionRanges) {
+        nodeCount += trialExecutor.getTrialNodeCount(*joinTree, firstPosition, endPosition, bestNodeCount - nodeCount);
+        if (nodeCount >= bestNodeCount) {
+          break; // cannot win
+        }
+      }
+    } // trial DDs are dead here
+    Dd::collectGarbage();
+
+    if (p.verboseSolving >= 1) {
+      io::printRow("autotune " + getName(heuristics.at(i)) + " nodes", nodeCount < bestNodeCount ? to_string(nodeCount) : ">" + to_string(bestNodeCount));
+    }
+    if (nodeCount < bestNodeCount) {
+      bestNodeCount = nodeCount;
+      bestIndex = i;
+    }
+  }
+
+  io::printRow("autotunedVarOrder", getName(heuristics.at(bestIndex)));
+  io::printRow("autotuneSeconds", util::getDuration(autotuneStartPoint));
+  io::Report::add("seconds", "autotune", util::getDuration(autotuneStartPoint));
+  return varOrders.at(bestIndex);
+}
+
+pair<Number, Assignment> Dpve::computeSolution(){
+  if (p.cnf.unsatisfiable) {
+    throw util::UnsatException();
+  }
+  if (!p.checkpointDir.empty()) {
+    string runKey = getDdMode() + " er=" + to_string(p.existRandom) + " pc=" + to_string(p.projectedCounting) + " wc=" + to_string(p.weightedCounting) + " weights=" + p.cnf.getWeightHash();
+    checkpoint = new Checkpoint(p.checkpointDir, p.cnf, runKey, p.checkpointSeconds, p.resume);
+  }
+  TimePoint joinTreeStartPoint = util::getTimePoint();
+  {
+    util::PerfScope perfScope("joinTreePhase");
+    setJoinTree();
+  }
+  io::Report::add("seconds", "joinTree", util::getDuration(joinTreeStartPoint)); // planning or waiting for planner
+  io::Report::add("joinTree", "width", joinTree->width);
   
   Map<Int, Number> unprunableWeights = p.cnf.getUnprunableWeights();
   if (!unprunableWeights.empty() && (p.pmParams.logBound > -INF || !p.pmParams.thresholdModel.empty() || p.pmParams.satSolverPruning)) {
-    JoinTreeProcessor::killPlanner();
+    if (p.clusteringHeuristic.empty()) {
+      JoinTreeProcessor::killPlanner();
+    }
     printLine();
     printLine("unprunable literal weights:");
     for (const auto& [literal, weight] : unprunableWeights) {
@@ -411,13 +1052,23 @@ pair<Number, Assignment> Dpve::computeSolution(){
   }
   
   TimePoint ddVarOrderStartPoint = util::getTimePoint();
-  const JoinNonterminal* joinRoot = joinTreeProcessor.getJoinTreeRoot();
-  vector<Int> ddVarToCnfVarMap ;
-  ddVarToCnfVarMap = joinRoot->getVarOrder(p.ddVarOrderHeuristic, p.cnf); // e.g. [42, 13], i.e. ddVarOrder
+  if (checkpoint != nullptr && checkpoint->resuming) {
+    ddVarToCnfVarMap = checkpoint->readVarOrder(); // so that DD vars of checkpointed run keep their indices
+  }
+  else {
+    util::PerfScope perfScope("varOrderPhase");
+    if (p.autotuneSubtrees > 0) {
+      ddVarToCnfVarMap = getAutotunedVarOrder();
+    }
+    else {
+      ddVarToCnfVarMap = joinTree->getVarOrder(p.ddVarOrderHeuristic, p.cnf); // e.g. [42, 13], i.e. ddVarOrder
+    }
+  }
   if (p.verboseSolving >= 1) {
     io::printRow("diagramVarSeconds", util::getDuration(ddVarOrderStartPoint));
   }
-  Map<Int, Int> cnfVarToDdVarMap; // e.g. {42: 0, 13: 1}
+  io::Report::add("seconds", "varOrder", util::getDuration(ddVarOrderStartPoint));
+  cnfVarToDdVarMap.assign(p.cnf.declaredVarCount + 1, -1); // e.g. {42: 0, 13: 1}
   for (Int ddVar = 0; ddVar < ddVarToCnfVarMap.size(); ddVar++) {
     Int cnfVar = ddVarToCnfVarMap.at(ddVar);
     cnfVarToDdVarMap[cnfVar] = ddVar;
@@ -425,12 +1076,19 @@ pair<Number, Assignment> Dpve::computeSolution(){
   if (p.dynVarOrdering == 1){
     printLine("Computing all reordering var orders.."," ");
     TimePoint levelOrdersStartPoint = util::getTimePoint();
+    vector<Int> heuristics;
     for (auto [v,s] : CNF_VAR_ORDER_HEURISTICS){
       if (v == COLAMD_HEURISTIC || v == RANDOM_HEURISTIC || v == LEX_M_HEURISTIC){
         continue;
       }
       printLine(s," ");
-      auto vo = joinRoot->getVarOrder(v, p.cnf); // returns d2cMap. i.e. vo[ddVarIndex] = cnfVarIndex
+      heuristics.push_back(v);
+    }
+
+    vector<vector<Int>> varOrders = getVarOrders(heuristics);
+    for (Int i = 0; i < heuristics.size(); i++) {
+      Int v = heuristics.at(i);
+      const vector<Int>& vo = varOrders.at(i); // returns d2cMap. i.e. vo[ddVarIndex] = cnfVarIndex
       //we will interpret vo as a reordering map. i.e. 
       // ddVarIndex will now be ddVarLevel since ddVarIndex for all variables will always be fixed
       // i.e. vo[ddVarLevel] = cnfVarIndex
@@ -449,27 +1107,59 @@ pair<Number, Assignment> Dpve::computeSolution(){
       //"The i-th entry of the permutation array contains the index of the variable that should be brought to the i-th level."
     }
     io::printRow("allDiagramOrdersSeconds", util::getDuration(levelOrdersStartPoint));
+    Dd::setReorderCandidates(levelMaps);
+
+    vector<vector<Int>> sampleDdVarSets; // about 4096 evenly spaced clauses, scored against candidate orders instead of shuffling heap
+    Int sampleStride = max(p.cnf.clauses.size() / 4096, (Int) 1);
+    for (Int clauseIndex = 0; clauseIndex < p.cnf.clauses.size(); clauseIndex += sampleStride) {
+      vector<Int> ddVars;
+      for (Int literal : p.cnf.clauses.at(clauseIndex)) {
+        ddVars.push_back(cnfVarToDdVarMap.at(abs(literal)));
+      }
+      sampleDdVarSets.push_back(ddVars);
+    }
+    Dd::reorderPolicy.setSample(sampleDdVarSets);
   }
   
   if (p.satFilter>0){
-    s = new SatFilter(p.cnf,cnfVarToDdVarMap,ddVarToCnfVarMap);
+    TimePoint satFilterStartPoint = util::getTimePoint();
+    util::PerfScope perfScope("satFilterPhase");
+    s = new SatFilter(p.cnf,cnfVarToDdVarMap,ddVarToCnfVarMap,nodeBdds);
     printLine("Computing SatFilter ...");
-    bool solution = s->solveSubtree(static_cast<const JoinNode*>(joinRoot)).isTrue();
+    bool solution = s->solveTree(*joinTree).isTrue();
     if (!solution){
       throw util::UnsatException();
     }
     printLine("Done constructing SatFilter. Applying SatFilter...");
-    s->filterBdds(joinRoot,Dd::getOneBdd());
+    s->filterBdds(*joinTree,Dd::getOneBdd());
     printLine("Done Applying SatFilter!");
+    io::Report::add("seconds", "satFilter", util::getDuration(satFilterStartPoint));
     printLine();
   }
   if(p.satFilter!=1){
+    if (p.statusSeconds > 0) {
+      monitor = new Monitor(p.statusSeconds, p.statusFile, p.memLimit);
+    }
     printLine("Starting executor...");
-    e = new Executor(p.cnf,cnfVarToDdVarMap,ddVarToCnfVarMap,p.existRandom,p.joinPriority,p.satFilter,p.verboseSolving,p.verboseProfiling, levelMaps);
+    TimePoint executionStartPoint = util::getTimePoint();
+    util::PerfScope perfScope("executionPhase"); // also counts maximizer extraction
+    if (!p.diagramCacheDir.empty()) {
+      subtreeCache = new SubtreeCache(p.diagramCacheDir, getDdMode(), p.diagramCacheSeconds);
+    }
+    e = new Executor(p.cnf,cnfVarToDdVarMap,ddVarToCnfVarMap,p.existRandom,p.joinPriority,p.satFilter,nodeBdds,p.verboseSolving,p.verboseProfiling, levelMaps, subtreeCache, checkpoint, monitor);
     setLogBound();
 
-    Dd res = e->solveSubtree(static_cast<const JoinNode*>(joinRoot), p.pmParams);
+    Dd res = e->solveTree(*joinTree, p.pmParams);
     Number apparentSolution = res.extractConst();
+    io::Report::add("seconds", "execution", util::getDuration(executionStartPoint));
+    if (subtreeCache != nullptr) {
+      printRow("loadedSubtreeDiagrams", subtreeCache->loadedDdCount);
+      printRow("storedSubtreeDiagrams", subtreeCache->storedDdCount);
+    }
+    if (checkpoint != nullptr) {
+      printRow("writtenCheckpoints", checkpoint->writtenCount);
+      checkpoint->remove(); // solved, so nothing to resume
+    }
 
     if (p.pmParams.logBound > -INF) {
       printRow("prunedDiagrams", Dd::prunedDdCount);
@@ -4,34 +4,132 @@
 #include "common.hpp"
 #include "decision_diagrams.hpp"
 #include "formula.hpp"
+#include "htb.hpp"
 #include "io.hpp"
 #include "jointrees.hpp"
 #include "sat_solver.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
 using dpve::io::PruneMaxParams;
 
 namespace dpve{
+class SubtreeCache { // on disk, shared by related formulas: DD of join subtree by hash of its clauses, projection vars and their weights
+  public:
+    const Float minSeconds; // subtrees solved faster are not stored
+    Int loadedDdCount = 0;
+    Int storedDdCount = 0;
+
+    bool hasDd(uint64_t subtreeHash) const;
+    Dd loadDd(uint64_t subtreeHash, const vector<Int>& cnfVarToDdVarMap);
+    void storeDd(uint64_t subtreeHash, const Dd& dd, const vector<Int>& ddVarToCnfVarMap);
+    SubtreeCache(const string& cacheDir, const string& ddMode, Float minSeconds); // DD mode names subdirectory, since leaf values depend on it
+
+  private:
+    string dirPath;
+    Set<uint64_t> cachedHashes; // listed once instead of a file lookup per node
+
+    string getFilePath(uint64_t subtreeHash) const;
+};
+
+class Checkpoint { // on disk, for resuming a long executor run on the same formula: post-order position, DD var order, DDs of solved subtrees
+  public:
+    const Float intervalSeconds;
+    bool resuming; // until DDs are read back
+    Int writtenCount = 0;
+
+    bool isDue() const; // interval has passed since latest checkpoint
+    void write(Int position, const vector<Dd>& childDdStack, const vector<Int>& ddVarToCnfVarMap, const vector<Int>& loadedPositions);
+    vector<Int> readVarOrder(); // ddVarToCnfVarMap of checkpointed run
+    Int readDds(const vector<Int>& cnfVarToDdVarMap, vector<Dd>& childDdStack, Set<Int>& loadedPositions); // after readVarOrder; returns post-order position to resume from
+    void remove(); // after solving
+    Checkpoint(const string& checkpointDir, const Cnf& cnf, const string& runKey, Float intervalSeconds, bool resuming); // run key: options and weights that DDs depend on
+
+  private:
+    const string filePath; // <cnf hash>.ck, beside join tree cache file of same formula
+    const string runKey; // first line of file, checked on resume
+    TimePoint latestWritePoint;
+    std::ifstream file; // of resumed checkpoint, read in order
+    Int position = MIN_INT; // of resumed checkpoint
+};
+
+class Monitor { // background sampler of RSS, unique table, cache and executor progress, with memory governor acting between join nodes
+  public:
+    void atSafePoint(Int processedJoinNodes, Int joinNodeCount); // on executor thread: publishes DD stats if requested, applies pending action; may throw AbortException
+    Monitor(Float intervalSeconds, const string& statusFilePath, Float memLimitMegabytes); // empty statusFilePath for status rows on stdout
+    ~Monitor(); // stops sampler
+
+  private:
+    enum Action {NO_ACTION, GC_ACTION, REORDER_ACTION, ABORT_ACTION}; // by severity; at 80%, 90%, 100% of memory limit
+
+    const Float intervalSeconds;
+    const Float memLimitMegabytes; // 0 if governor is off
+    std::ofstream statusFile; // appended, so that history survives a kill
+
+    /* written by executor thread, read by sampler: */
+    std::atomic<Int> processedJoinNodes = 0;
+    std::atomic<Int> joinNodeCount = 0;
+    std::atomic<size_t> tableNodeCount = 0;
+    std::atomic<size_t> tableSlotCount = 0;
+    std::atomic<double> cacheHitRate = -1;
+
+    /* written by sampler, taken by executor thread: */
+    std::atomic<bool> statsRequested = true; // DD stats are only safe to read on executor thread
+    std::atomic<int> pendingAction = NO_ACTION;
+
+    std::thread sampler;
+    std::mutex mutex;
+    std::condition_variable stopCondition;
+    bool stopping = false;
+
+    static Float getRssMegabytes(); // from /proc/self/statm
+    void sample(); // loop of sampler thread
+    [[noreturn]] void exitWithReport(Int joinNode); // from sampler thread when executor is stuck in a join node past memory limit: writes partial report, trace and counters first
+};
+
 class Executor {
   public:
-    Dd solveSubtree(const JoinNode* joinNode, const PruneMaxParams& pmParams, const Assignment& assignment = Assignment());
+    Dd solveTree(const JoinTree& joinTree, const PruneMaxParams& pmParams, const Assignment& assignment = Assignment()); // in post order, without recursion
+    size_t getTrialNodeCount(const JoinTree& joinTree, Int firstPosition, Int endPosition, size_t nodeCountLimit); // of products in post-order range of a subtree, without maximization; stops past limit
     Assignment getMaximizer(Int declaredVarCount);
-    Executor(const Cnf& cnf, const Map<Int, Int>& cnfVarToDdVarMap, const vector<Int>& ddVarToCnfVarMap, const bool existRandom, 
-      const string joinPriority, const Int satFilter, const Int verboseSolving, const Int verboseProfiling,
-      const Map<Int, vector<Int>> levelMaps_ = Map<Int, vector<Int>>());
+    Executor(const Cnf& cnf, const vector<Int>& cnfVarToDdVarMap, const vector<Int>& ddVarToCnfVarMap, const bool existRandom, 
+      const string joinPriority, const Int satFilter, vector<Dd>& nodeBdds, const Int verboseSolving, const Int verboseProfiling,
+      const Map<Int, vector<Int>> levelMaps_ = Map<Int, vector<Int>>(), SubtreeCache* subtreeCache = nullptr, Checkpoint* checkpoint = nullptr,
+      Monitor* monitor = nullptr);
     
     Float reOrdThresh = 0.7;
 
   private:
     const Cnf& cnf;
-    const Map<Int, Int>& cnfVarToDdVarMap;
+    const vector<Int>& cnfVarToDdVarMap; // CNF var |-> DD var, or -1 for non-apparent var
     const vector<Int>& ddVarToCnfVarMap;
     vector<pair<Int, Dd>> maximizationStack; // pair<DD var, derivative sign>
+
+    /* dense by CNF var, instead of hash lookups per node: */
+    vector<Number> positiveWeights;
+    vector<Number> negativeWeights;
+    vector<bool> additiveFlags; // else var is maximized
+    vector<Int> varAsmts; // 0: unassigned, +1: positive asnmt, -1: negative asnmt; set during solveTree
+
+    /* scratch buffers reused by nodes: */
+    vector<DdLiteral> clauseLiterals;
+    vector<DdVarWeight> ddVarWts;
     
     const Map<Int, vector<Int>>& levelMaps;
+    SubtreeCache* subtreeCache; // null if subtree DDs are not cached
+    Checkpoint* checkpoint; // null if progress is not saved
+    Monitor* monitor; // null if not sampled
+
+    vector<uint64_t> getSubtreeHashes(const JoinTree& joinTree) const; // node |-> hash, independent of node indices and child order
 
     const bool existRandom;
     const string joinPriority; 
     const Int satFilter; 
+    vector<Dd>& nodeBdds; // node |-> BDD kept by SatFilter
 
     const Int verboseSolving;
     const Int verboseProfiling;
@@ -44,13 +142,14 @@ class Executor {
 
 class SatFilter{
   public:
-    Dd solveSubtree(const JoinNode* joinNode);
-    bool filterBdds(const JoinNode* joinNode,const Dd parentBdd);
-    SatFilter(const Cnf& cnf, const Map<Int, Int>& cnfVarToDdVarMap,const vector<Int>& ddVarToCnfVarMap);
+    Dd solveTree(const JoinTree& joinTree); // in post order, without recursion; sets `nodeBdds`
+    bool filterBdds(const JoinTree& joinTree,const Dd parentBdd);
+    SatFilter(const Cnf& cnf, const vector<Int>& cnfVarToDdVarMap,const vector<Int>& ddVarToCnfVarMap, vector<Dd>& nodeBdds);
   private:
-  const Map<Int, Int>& cnfVarToDdVarMap;
+  const vector<Int>& cnfVarToDdVarMap; // CNF var |-> DD var
   const vector<Int>& ddVarToCnfVarMap;
   const Cnf& cnf;
+  vector<Dd>& nodeBdds; // node |-> BDD before projection if node has projection vars, else one
 
   TimePoint satFilterStartPoint;
   Int joinNodesProcessed=0;
@@ -58,20 +157,29 @@ class SatFilter{
   string joinPriority;
 
   Dd getClauseBdd(const Clause& clause);
-  // recursively computes valuation of join tree node
 };
 
 class Dpve{
   private:
     Executor *e;
     SatFilter *s;
-    const JoinNonterminal* joinRoot;
+    const JoinTree* joinTree;
+    vector<Dd> nodeBdds; // node |-> BDD from SatFilter, shared with Executor
     const io::InputParams& p;    
-    Map<Int, Int> cnfVarToDdVarMap;
-    const vector<Int> ddVarToCnfVarMap;
+    vector<Int> cnfVarToDdVarMap; // CNF var |-> DD var, or -1 for non-apparent var
+    vector<Int> ddVarToCnfVarMap;
     Map<Int,vector<Int>> levelMaps;
+    SubtreeCache* subtreeCache = nullptr;
+    Checkpoint* checkpoint = nullptr;
+    Monitor* monitor = nullptr;
 
+    void setJoinTree(); // from planner process via stdin or from in-process planner
+    void storeJoinTree(const JoinTreeCache& joinTreeCache) const; // also beside checkpoint
     void setLogBound();
+    string getDdMode() const; // DD package, log counting, multiple precision: leaf values depend on these
+    vector<vector<Int>> getVarOrders(const vector<Int>& heuristics) const; // d2cMaps, computed concurrently
+    vector<pair<Int, Int>> getSampledSubtrees(Int sampleCount) const; // post-order ranges [first, end) of biggest disjoint subtrees under a size cap
+    vector<Int> getAutotunedVarOrder(); // of candidate heuristics, the one whose trial DDs of sampled subtrees have fewest nodes
 
     Number adjustSolutionToHiddenVar(const Number &apparentSolution, Int cnfVar, const bool additiveFlag);
     Number getAdjustedSolution(const Number &apparentSolution);
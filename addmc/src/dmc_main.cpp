@@ -1,6 +1,8 @@
 #include "dmc.hpp"
 #include "util.hpp"
 
+#include <sys/resource.h>
+
 using dpve::io::printRow;
 using dpve::Number;
 using dpve::io::InputParams;
@@ -16,8 +18,16 @@ int main(int argc, char** argv) {
   std::cout << std::unitbuf; // enables automatic flushing
   dpve::io::printPreamble(argc,argv);
   InputParams p = dpve::io::parseOptions(argc,argv);
+  dpve::io::Report::add("seconds", "parse", getDuration(p.toolStartPoint)); // mostly reading CNF file
   assert(dpve::io::validateOptions(p));
   p.printParsed();
+  if (p.hardwareCounters) {
+    dpve::util::PerfCounters::open();
+  }
+  if (!p.traceFile.empty()) {
+    dpve::util::Trace::open(p.traceFile);
+  }
+  bool aborted = false;
   try{
     Dpve d(p);
     auto [adjustedSolution, maximizer] = d.computeSolution();
@@ -45,11 +55,27 @@ int main(int argc, char** argv) {
         if (p.verboseSolving >= 1) {
           printRow("maximizerVerificationSeconds", getDuration(maximizerVerificationStartPoint));
         }
+        dpve::io::Report::add("seconds", "verification", getDuration(maximizerVerificationStartPoint));
       }
     }
   }
+  catch (const dpve::util::AbortException& e) { // stats, counters and report below are partial results
+    printRow("aborted", e.reason);
+    aborted = true;
+  }
   catch (dpve::util::UnsatException) {
     dpve::io::printAdjustedSolutionRows(p.logCounting ? Number(-dpve::INF) : Number(),p.pmParams.satSolverPruning,p.logCounting,p.weightedCounting,p.multiplePrecision,p.existRandom,p.projectedCounting, true);
   }
+  dpve::util::Trace::close();
+  if (dpve::util::PerfCounters::isOpen()) {
+    dpve::util::PerfCounters::printRows();
+    dpve::util::PerfCounters::close();
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  dpve::io::Report::add("memory", "peakRssMegabytes", usage.ru_maxrss / 1024.0); // ru_maxrss is in kilobytes on Linux
+  dpve::io::Report::add("seconds", "total", getDuration(p.toolStartPoint));
   printRow("seconds", getDuration(p.toolStartPoint));
+  dpve::io::Report::close();
+  return aborted ? 1 : 0;
 }
\ No newline at end of file
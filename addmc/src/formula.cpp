@@ -3,8 +3,9 @@
 #include "../libraries/colamd/colamd.h"
 #include "io.hpp"
 #include "util.hpp"
-#include <fstream>
+#include <algorithm>
 #include <iomanip>
+#include <numeric>
 #include <random>
 /* class Clause ============================================================= */
 
@@ -29,19 +30,10 @@ using util::MyError;
 using util::EmptyClauseException;
 using io::printRow;
 
-Clause::Clause(bool xorFlag) {
+Clause::Clause(std::span<const Int> literals, bool xorFlag) : std::span<const Int>(literals) {
   this->xorFlag = xorFlag;
 }
 
-void Clause::insertLiteral(Int literal) {
-  if (xorFlag && contains(literal)) {
-    erase(literal);
-  }
-  else {
-    insert(literal);
-  }
-}
-
 void Clause::printClause() const {
   cout << (xorFlag ? " x" : "  ");
   for (auto it = begin(); it != end(); it++) {
@@ -58,6 +50,143 @@ Set<Int> Clause::getClauseVars() const {
   return vars;
 }
 
+/* class ClauseArena ======================================================== */
+
+Clause ClauseArena::iterator::operator*() const {
+  return arena->at(clauseIndex);
+}
+
+ClauseArena::iterator& ClauseArena::iterator::operator++() {
+  clauseIndex++;
+  return *this;
+}
+
+bool ClauseArena::iterator::operator!=(const iterator& other) const {
+  return clauseIndex != other.clauseIndex;
+}
+
+Int ClauseArena::size() const {
+  return xorFlags.size();
+}
+
+Clause ClauseArena::at(Int clauseIndex) const {
+  const Int* first = literals.data() + literalOffsets.at(clauseIndex);
+  const Int* last = literals.data() + literalOffsets.at(clauseIndex + 1);
+  return Clause(std::span<const Int>(first, last), xorFlags.at(clauseIndex));
+}
+
+ClauseArena::iterator ClauseArena::begin() const {
+  return iterator{this, 0};
+}
+
+ClauseArena::iterator ClauseArena::end() const {
+  return iterator{this, size()};
+}
+
+void ClauseArena::startClause(bool xorFlag) {
+  literals.resize(literalOffsets.back()); // discards unfinished clause
+  startedXorFlag = xorFlag;
+}
+
+void ClauseArena::insertLiteral(Int literal) {
+  Int start = literalOffsets.back();
+  bool indexed = literals.size() - start >= LONG_CLAUSE_SIZE;
+
+  Int position = -1; // of duplicate in started clause
+  if (indexed) {
+    Int key = 2 * abs(literal) + (literal < 0);
+    if (key < literalPositions.size()) {
+      Int p = literalPositions[key];
+      if (p >= start && p < literals.size() && literals[p] == literal) {
+        position = p;
+      }
+    }
+  }
+  else { // scanning short clause is cheaper than random access to `literalPositions`
+    auto it = find(literals.begin() + start, literals.end(), literal);
+    if (it != literals.end()) {
+      position = it - literals.begin();
+    }
+  }
+
+  if (position < 0) {
+    literals.push_back(literal);
+    if (indexed) {
+      indexLiteral(literals.size() - 1);
+    }
+    else if (literals.size() - start == LONG_CLAUSE_SIZE) {
+      for (Int i = start; i < literals.size(); i++) {
+        indexLiteral(i);
+      }
+    }
+  }
+  else if (startedXorFlag) { // cancels duplicate by moving last literal into its position
+    literals[position] = literals.back();
+    literals.pop_back();
+    if (indexed && position < literals.size()) {
+      indexLiteral(position);
+    }
+  }
+}
+
+void ClauseArena::indexLiteral(Int position) {
+  Int literal = literals[position];
+  Int key = 2 * abs(literal) + (literal < 0);
+  if (key >= literalPositions.size()) {
+    literalPositions.resize(max(key + 1, 2 * static_cast<Int>(literalPositions.size())), -1);
+  }
+  literalPositions[key] = position;
+}
+
+Int ClauseArena::getStartedClauseSize() const {
+  return literals.size() - literalOffsets.back();
+}
+
+void ClauseArena::finishClause() {
+  literalOffsets.push_back(literals.size());
+  xorFlags.push_back(startedXorFlag);
+}
+
+void ClauseArena::setOccurrences(Int varCount) {
+  literals.shrink_to_fit();
+  literalPositions = vector<Int>();
+
+  vector<Int> latestClauseIndices(varCount + 1, -1); // var |-> latest clause counted for var, which may occur with both signs
+  occurrenceOffsets = vector<Int>(varCount + 2);
+  for (Int clauseIndex = 0; clauseIndex < size(); clauseIndex++) {
+    for (Int literal : at(clauseIndex)) {
+      Int var = abs(literal);
+      if (latestClauseIndices.at(var) != clauseIndex) {
+        latestClauseIndices.at(var) = clauseIndex;
+        occurrenceOffsets.at(var + 1)++;
+      }
+    }
+  }
+  for (Int var = 0; var <= varCount; var++) {
+    occurrenceOffsets.at(var + 1) += occurrenceOffsets.at(var);
+  }
+
+  occurrences = vector<Int>(occurrenceOffsets.back());
+  vector<Int> nextIndices(occurrenceOffsets.begin(), occurrenceOffsets.end() - 1);
+  latestClauseIndices.assign(varCount + 1, -1);
+  for (Int clauseIndex = 0; clauseIndex < size(); clauseIndex++) {
+    for (Int literal : at(clauseIndex)) {
+      Int var = abs(literal);
+      if (latestClauseIndices.at(var) != clauseIndex) {
+        latestClauseIndices.at(var) = clauseIndex;
+        occurrences.at(nextIndices.at(var)++) = clauseIndex;
+      }
+    }
+  }
+}
+
+std::span<const Int> ClauseArena::getOccurrences(Int var) const {
+  if (var + 1 >= occurrenceOffsets.size()) {
+    return std::span<const Int>();
+  }
+  return std::span<const Int>(occurrences.data() + occurrenceOffsets.at(var), occurrences.data() + occurrenceOffsets.at(var + 1));
+}
+
 /* class Cnf ================================================================ */
 
 Set<Int> Cnf::getInnerVars() const {
@@ -80,6 +209,67 @@ Map<Int, Number> Cnf::getUnprunableWeights() const {
   return unprunableWeights;
 }
 
+vector<Int> Cnf::getCanonicalClauseOrder() const {
+  vector<vector<Int>> sortedClauses;
+  for (Clause clause : clauses) {
+    vector<Int> literals(clause.begin(), clause.end());
+    std::sort(literals.begin(), literals.end());
+    sortedClauses.push_back(literals);
+  }
+  vector<Int> clauseIndices(clauses.size());
+  std::iota(clauseIndices.begin(), clauseIndices.end(), 0);
+  std::stable_sort(clauseIndices.begin(), clauseIndices.end(), [&](Int i, Int j) {
+    bool xorFlagI = clauses.at(i).xorFlag;
+    bool xorFlagJ = clauses.at(j).xorFlag;
+    return xorFlagI != xorFlagJ ? xorFlagI < xorFlagJ : sortedClauses.at(i) < sortedClauses.at(j);
+  });
+  return clauseIndices;
+}
+
+string Cnf::getHash() const {
+  uint64_t hash = util::HASH_SEED;
+  auto mix = [&hash](Int word) { util::mixHash(hash, word); };
+
+  mix(declaredVarCount);
+  mix(projectedCounting);
+  vector<Int> sortedOuterVars(outerVars.begin(), outerVars.end()); // set iteration order is unspecified
+  std::sort(sortedOuterVars.begin(), sortedOuterVars.end());
+  mix(sortedOuterVars.size());
+  for (Int var : sortedOuterVars) {
+    mix(var);
+  }
+  mix(clauses.size());
+  for (Int clauseIndex : getCanonicalClauseOrder()) { // so that reordering clauses or literals keeps hash
+    Clause clause = clauses.at(clauseIndex);
+    vector<Int> literals(clause.begin(), clause.end());
+    std::sort(literals.begin(), literals.end());
+    mix(clause.xorFlag ? -Int(literals.size()) : Int(literals.size()));
+    for (Int literal : literals) {
+      mix(literal);
+    }
+  }
+
+  return util::getHexString(hash);
+}
+
+string Cnf::getWeightHash() const {
+  uint64_t hash = util::HASH_SEED;
+  for (Int var = 1; var <= declaredVarCount; var++) {
+    for (Int literal : {var, -var}) {
+      const Number& weight = literalWeights.at(literal);
+      std::ostringstream stream;
+      if (Number::multiplePrecision) {
+        stream << weight.quotient.get_str();
+      }
+      else {
+        stream << std::hexfloat << weight.fraction; // exact
+      }
+      util::mixHash(hash, stream.str());
+    }
+  }
+  return util::getHexString(hash);
+}
+
 void Cnf::printLiteralWeight(Int literal, const Number& weight) {
   cout << "c  weight " << right << setw(5) << literal << ": " << weight << "\n";
 }
@@ -100,39 +290,25 @@ void Cnf::printClauses() const {
   }
 }
 
-void Cnf::addClause(const Clause& clause) {
-  Int clauseIndex = clauses.size();
-  clauses.push_back(clause);
-  for (Int literal : clause) {
-    Int var = abs(literal);
-    auto it = varToClauses.find(var);
-    if (it != varToClauses.end()) {
-      it->second.insert(clauseIndex);
-    }
-    else {
-      varToClauses[var] = {clauseIndex};
-    }
-  }
-}
-
 void Cnf::setApparentVars() {
-  for (const pair<Int, Set<Int>>& kv : varToClauses) {
-    apparentVars.insert(kv.first);
+  clauses.setOccurrences(declaredVarCount);
+  for (Int var = 1; var <= declaredVarCount; var++) {
+    if (!clauses.getOccurrences(var).empty()) {
+      apparentVars.insert(var);
+    }
   }
 }
-
-Graph Cnf::getPrimalGraph() const {
-  Graph graph(apparentVars);
-  for (const Clause& clause : clauses) {
-    for (auto literal1 = clause.begin(); literal1 != clause.end(); literal1++) {
-      for (auto literal2 = next(literal1); literal2 != clause.end(); literal2++) {
-        Int var1 = abs(*literal1);
-        Int var2 = abs(*literal2);
-        graph.addEdge(var1, var2);
-      }
+const Graph& Cnf::getPrimalGraph() const {
+  std::lock_guard<std::mutex> lock(*primalGraphMutex);
+  if (!primalGraph) {
+    vector<Int> clauseVars; // flat, delimited by `clauses.literalOffsets`
+    clauseVars.reserve(clauses.literals.size());
+    for (Int literal : clauses.literals) {
+      clauseVars.push_back(abs(literal));
     }
+    primalGraph = std::make_shared<const Graph>(vector<Int>(apparentVars.begin(), apparentVars.end()), clauses.literalOffsets, clauseVars);
   }
-  return graph;
+  return *primalGraph;
 }
 
 vector<Int> Cnf::getRandomVarOrder() const {
@@ -155,8 +331,10 @@ vector<Int> Cnf::getDeclarationVarOrder() const {
 
 vector<Int> Cnf::getMostClausesVarOrder() const {
   multimap<Int, Int, greater<Int>> m; // clause count |-> var
-  for (const auto& [var, clauseIndices] : varToClauses) {
-    m.insert({clauseIndices.size(), var});
+  for (Int var = 1; var <= declaredVarCount; var++) {
+    if (apparentVars.contains(var)) {
+      m.insert({clauses.getOccurrences(var).size(), var});
+    }
   }
 
   vector<Int> varOrder;
@@ -167,123 +345,19 @@ vector<Int> Cnf::getMostClausesVarOrder() const {
 }
 
 vector<Int> Cnf::getMinFillVarOrder() const {
-  vector<Int> varOrder;
-
-  Graph graph = getPrimalGraph();
-  while (!graph.vertices.empty()) {
-    Int vertex = graph.getMinFillVertex();
-    graph.fillInEdges(vertex);
-    graph.removeVertex(vertex);
-    varOrder.push_back(vertex);
-  }
-
-  return varOrder;
+  return FillGraph(getPrimalGraph()).getMinFillVertexOrder();
 }
 
 vector<Int> Cnf::getMcsVarOrder() const {
-  Graph graph = getPrimalGraph();
-
-  auto startVertex = graph.vertices.begin();
-  if (startVertex == graph.vertices.end()) {
-    return vector<Int>();
-  }
-
-  Map<Int, Int> rankedNeighborCounts; // unranked vertex |-> number of ranked neighbors
-  for (auto it = next(startVertex); it != graph.vertices.end(); it++) {
-    rankedNeighborCounts[*it] = 0;
-  }
-
-  Int bestVertex = *startVertex;
-  Int bestRankedNeighborCount = MIN_INT;
-
-  vector<Int> varOrder;
-  do {
-    varOrder.push_back(bestVertex);
-
-    rankedNeighborCounts.erase(bestVertex);
-
-    for (Int n : graph.adjacencyMap.at(bestVertex)) {
-      auto entry = rankedNeighborCounts.find(n);
-      if (entry != rankedNeighborCounts.end()) {
-        entry->second++;
-      }
-    }
-
-    bestRankedNeighborCount = MIN_INT;
-    for (pair<Int, Int> entry : rankedNeighborCounts) {
-      if (entry.second > bestRankedNeighborCount) {
-        bestRankedNeighborCount = entry.second;
-        bestVertex = entry.first;
-      }
-    }
-  }
-  while (bestRankedNeighborCount != MIN_INT);
-
-  return varOrder;
+  return getPrimalGraph().getMcsVertexOrder();
 }
 
 vector<Int> Cnf::getLexPVarOrder() const {
-  Map<Int, Label> unnumberedVertices;
-  for (Int vertex : apparentVars) {
-    unnumberedVertices[vertex] = Label();
-  }
-  vector<Int> numberedVertices; // whose alpha numbers are decreasing
-  Graph graph = getPrimalGraph();
-  for (Int number = apparentVars.size(); number > 0; number--) {
-    Int vertex = max_element(unnumberedVertices.begin(), unnumberedVertices.end(), Label::hasSmallerLabel)->first; // ignores label
-    numberedVertices.push_back(vertex);
-    unnumberedVertices.erase(vertex);
-    for (Int neighbor : graph.adjacencyMap.at(vertex)) {
-      auto unnumberedNeighborIt = unnumberedVertices.find(neighbor);
-      if (unnumberedNeighborIt != unnumberedVertices.end()) {
-        Int unnumberedNeighbor = unnumberedNeighborIt->first;
-        unnumberedVertices.at(unnumberedNeighbor).addNumber(number);
-      }
-    }
-  }
-  return numberedVertices;
+  return getPrimalGraph().getLexPVertexOrder();
 }
 
 vector<Int> Cnf::getLexMVarOrder() const {
-  Map<Int, Label> unnumberedVertices;
-  for (Int vertex : apparentVars) {
-    unnumberedVertices[vertex] = Label();
-  }
-  vector<Int> numberedVertices; // whose alpha numbers are decreasing
-  Graph graph = getPrimalGraph();
-  for (Int i = apparentVars.size(); i > 0; i--) {
-    Int v = max_element(unnumberedVertices.begin(), unnumberedVertices.end(), Label::hasSmallerLabel)->first; // ignores label
-    numberedVertices.push_back(v);
-    unnumberedVertices.erase(v);
-
-    /* updates numberedVertices: */
-    Graph subgraph = getPrimalGraph(); // will only contain v, w, and unnumbered vertices whose labels are less than w's label
-    for (pair<const Int, Label>& wAndLabel : unnumberedVertices) {
-      Int w = wAndLabel.first;
-      Label& wLabel = wAndLabel.second;
-
-      /* removes numbered vertices except v: */
-      for (Int numberedVertex : numberedVertices) {
-        if (numberedVertex != v) {
-          subgraph.removeVertex(numberedVertex);
-        }
-      }
-
-      /* removes each non-w unnumbered vertex whose label is at least w's labels */
-      for (const pair<Int, Label>& kv : unnumberedVertices) {
-        Int unnumberedVertex = kv.first;
-        const Label& label = kv.second;
-        if (unnumberedVertex != w && label >= wLabel) {
-          subgraph.removeVertex(unnumberedVertex);
-        }
-      }
-
-      if (subgraph.hasPath(v, w)) {
-        wLabel.addNumber(i);
-      }
-    }
-  }
-  return numberedVertices;
+  return getPrimalGraph().getLexMVertexOrder();
 }
 
 vector<Int> Cnf::getColAMDVarOrder() const {
@@ -297,7 +371,11 @@ vector<Int> Cnf::getColAMDVarOrder() const {
   uint64_t nCols = apparentVars.size();
   p.push_back(0);
   vector<Int> colToVar;
-  for (const auto& [var, clauseIndices] : varToClauses) {
+  for (Int var = 1; var <= declaredVarCount; var++) {
+    std::span<const Int> clauseIndices = clauses.getOccurrences(var);
+    if (clauseIndices.empty()) {
+      continue;
+    }
     uint32_t nCls = clauseIndices.size();
     p.push_back(p.back()+nCls);
     for (auto ind: clauseIndices){
@@ -428,31 +506,28 @@ void Cnf::printStats() const {
 void Cnf::readCnfFile(const string& filePath) {
   cout << "c processing CNF formula...\n";
 
-  std::ifstream inputFileStream(filePath);
-  if (!inputFileStream.is_open()) {
-    throw MyError("unable to open file '", filePath, "'");
-  }
+  TimePoint readStartPoint = util::getTimePoint();
+  util::InputFile file(filePath); // possibly compressed
 
   Int declaredClauseCount = MIN_INT;
 
   Int lineIndex = 0;
   Int problemLineIndex = MIN_INT;
 
-  string line;
-  while (getline(inputFileStream, line)) {
+  std::string_view line;
+  while (file.getLine(line)) {
     lineIndex++;
-    std::istringstream inStringStream(line);
 
     if (verboseCnf >= 3) {
-      io::printInputLine(line, lineIndex);
+      io::printInputLine(string(line), lineIndex);
     }
 
-    vector<string> words = util::splitInputLine(line);
-    if (words.empty()) {
+    std::string_view lineRest = line; // words are consumed in place, without copying
+    std::string_view frontWord = util::getNextWord(lineRest);
+    if (frontWord.empty()) {
       continue;
     }
-    string& frontWord = words.front();
-    if (Set<string>{"s", "INDETERMINATE"}.contains(frontWord)) { // preprocessor pmc
+    if (frontWord == "s" || frontWord == "INDETERMINATE") { // preprocessor pmc
       throw MyError("unexpected output from preprocessor pmc | line ", lineIndex, ": ", line);
     }
     else if (frontWord == "p") { // problem line
@@ -462,6 +537,7 @@ void Cnf::readCnfFile(const string& filePath) {
 
       problemLineIndex = lineIndex;
 
+      vector<string> words = util::splitInputLine(string(line));
       if (words.size() != 4) {
         throw MyError("problem line ", lineIndex, " has ", words.size(), " words (should be 4)");
       }
@@ -470,6 +546,10 @@ void Cnf::readCnfFile(const string& filePath) {
       declaredClauseCount = stoll(words.at(3));
     }
     else if (frontWord == "c") { // possibly show or weight line
+      if (!projectedCounting && !weightedCounting) {
+        continue;
+      }
+      vector<string> words = util::splitInputLine(string(line));
       if (projectedCounting && isMc21ShowLine(words)) {
         if (problemLineIndex == MIN_INT) {
           throw MyError("no problem line before outer vars | line ", lineIndex, ": ", line);
@@ -519,43 +599,52 @@ void Cnf::readCnfFile(const string& filePath) {
         xorFlag = true;
         xorClauseCount++;
 
-        if (frontWord == "x") {
-          words.erase(words.begin());
-        }
-        else {
-          frontWord.erase(frontWord.begin());
+        frontWord.remove_prefix(1);
+        if (frontWord.empty()) {
+          frontWord = util::getNextWord(lineRest);
         }
       }
-      Clause clause(xorFlag);
+      clauses.startClause(xorFlag);
 
-      for (Int i = 0; i < words.size(); i++) {
-        Int num = stoll(words.at(i));
+      bool terminated = false;
+      for (std::string_view word = frontWord; !word.empty(); word = util::getNextWord(lineRest)) {
+        Int num = util::parseInt(word);
 
         if (abs(num) > declaredVarCount) {
           throw MyError("literal '", num, "' inconsistent with declared var count '", declaredVarCount, "' | line ", lineIndex);
         }
 
         if (num == 0) {
-          if (i != words.size() - 1) {
+          if (!util::getNextWord(lineRest).empty()) {
             throw MyError("clause terminated prematurely by '0' | line ", lineIndex);
           }
 
-          if (clause.empty()) {
-            throw EmptyClauseException(lineIndex, line);
+          if (clauses.getStartedClauseSize() == 0) {
+            throw EmptyClauseException(lineIndex, string(line));
           }
 
-          addClause(clause);
+          clauses.finishClause();
+          terminated = true;
+          break;
         }
         else { // literal
-          if (i == words.size() - 1) {
-            throw MyError("missing end-of-clause indicator '0' | line ", lineIndex);
-          }
-          clause.insertLiteral(num);
+          clauses.insertLiteral(num);
         }
       }
+      if (!terminated) {
+        throw MyError("missing end-of-clause indicator '0' | line ", lineIndex);
+      }
     }
   }
 
+  if (verboseCnf >= 1) {
+    Float readSeconds = util::getDuration(readStartPoint);
+    printRow("cnfCompression", file.getCompression());
+    printRow("cnfFileMegabytes", file.getByteCount() / MEGA); // decoded
+    printRow("cnfReadSeconds", readSeconds);
+    printRow("cnfReadMegabytesPerSecond", file.getByteCount() / MEGA / max(readSeconds, 1e-3l));
+  }
+
   if (problemLineIndex == MIN_INT) {
     throw MyError("no problem line before CNF file ends on line ", lineIndex);
   }
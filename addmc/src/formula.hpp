@@ -3,30 +3,69 @@
 #include "types.hpp"
 #include "graph.hpp"
 
+#include <memory>
+#include <mutex>
+#include <span>
 #include <vector>
 #include <string>
 
 namespace dpve{
 
-class Clause : public Set<Int> {
+class Clause : public std::span<const Int> { // view of literals in a ClauseArena
 public:
   bool xorFlag;
 
-  Clause(bool xorFlag);
-
-  void insertLiteral(Int literal);
+  Clause(std::span<const Int> literals, bool xorFlag);
 
   void printClause() const;
   Set<Int> getClauseVars() const;
 };
 
+class ClauseArena { // literals of all clauses stored contiguously, with var occurrences in compressed sparse rows
+public:
+  vector<Int> literals; // literals of started clause come after those of finished clauses
+  vector<Int> literalOffsets{0}; // clause index |-> index in `literals` of first literal; last entry starts started clause
+  vector<bool> xorFlags; // clause index |-> whether clause is XOR
+  bool startedXorFlag = false;
+  vector<Int> literalPositions; // 2 * var + (literal < 0) |-> latest index in `literals` of literal, for duplicates in long clauses
+  static const Int LONG_CLAUSE_SIZE = 16; // shorter started clause is scanned for duplicates instead
+
+  vector<Int> occurrenceOffsets{0}; // var |-> index in `occurrences` of first clause containing var; last entry is `occurrences.size()`
+  vector<Int> occurrences; // clause indices, ascending for each var
+
+  class iterator {
+  public:
+    const ClauseArena* arena;
+    Int clauseIndex;
+
+    Clause operator*() const;
+    iterator& operator++();
+    bool operator!=(const iterator& other) const;
+  };
+
+  Int size() const; // number of finished clauses
+  Clause at(Int clauseIndex) const;
+  iterator begin() const;
+  iterator end() const;
+
+  void startClause(bool xorFlag);
+  void insertLiteral(Int literal); // into started clause: duplicate literal is ignored, or cancelled in XOR clause
+  void indexLiteral(Int position); // in `literalPositions`
+  Int getStartedClauseSize() const;
+  void finishClause();
+
+  void setOccurrences(Int varCount); // after all clauses are finished
+  std::span<const Int> getOccurrences(Int var) const; // clause indices
+};
+
 class Cnf {
 public:
   Int declaredVarCount = 0;
   Set<Int> outerVars;
   Map<Int, Number> literalWeights; // for outer and inner vars
-  vector<Clause> clauses;
+  ClauseArena clauses;
   Int xorClauseCount = 0;
+  bool unsatisfiable = false; // found by preprocessing, which then leaves clauses unchanged
 
   const Int verboseCnf;
   const Int randomSeed;
@@ -34,18 +73,21 @@ public:
   const bool projectedCounting;
 
   Set<Int> apparentVars; // as opposed to hidden vars that are declared but appear in no clause
-  Map<Int, Set<Int>> varToClauses; // apparent var |-> clause indices
+  mutable std::shared_ptr<const Graph> primalGraph; // over apparent vars, built on first use and shared by var order heuristics across threads
+  std::shared_ptr<std::mutex> primalGraphMutex = std::make_shared<std::mutex>(); // shared by copies
 
   Set<Int> getInnerVars() const;
   Map<Int, Number> getUnprunableWeights() const;
+  vector<Int> getCanonicalClauseOrder() const; // canonical clause rank |-> clause index, by sorted literals, so that files keyed by hash number clauses alike
+  string getHash() const; // of clauses and outer vars (not weights), up to clause and literal order, so that equal formulas share join trees
+  string getWeightHash() const; // of literal weights, exactly, for files whose contents depend on them
 
   static void printLiteralWeight(Int literal, const Number& weight);
   void printLiteralWeights() const;
   void printClauses() const;
 
-  void addClause(const Clause& clause);
   void setApparentVars();
-  Graph getPrimalGraph() const;
+  const Graph& getPrimalGraph() const; // thread-safe
   vector<Int> getRandomVarOrder() const;
   vector<Int> getDeclarationVarOrder() const;
   vector<Int> getMostClausesVarOrder() const;
@@ -1,122 +1,374 @@
 #include "graph.hpp"
 #include "util.hpp"
 
+#include <algorithm>
+#include <set>
+
+using dpve::FillGraph;
 using dpve::Graph;
-using dpve::Label;
+using dpve::InducedSubgraph;
 using dpve::Int;
+using dpve::LabelRanks;
+
+using std::max;
 
-using std::next;
 /* class Graph ============================================================== */
 
-Graph::Graph(const Set<Int>& vs) {
-  for (Int v : vs) {
-    vertices.insert(v);
-    adjacencyMap[v] = Set<Int>();
+Graph::Graph() {
+  offsets.push_back(0);
+}
+
+Graph::Graph(const vector<Int>& vs, const vector<Int>& cliqueOffsets, const vector<Int>& cliqueVertices) {
+  vertices = vs;
+  sort(vertices.begin(), vertices.end());
+  Int vertexCount = vertices.size();
+
+  denseIds = vector<Int>(vertices.empty() ? 0 : vertices.back() + 1, -1);
+  for (Int u = 0; u < vertexCount; u++) {
+    denseIds.at(vertices.at(u)) = u;
+  }
+
+  /* scatters clique edges into rows while reading cliques in order, then sorts and deduplicates each row: */
+  offsets = vector<Int>(vertexCount + 1);
+  for (Int i = 0; i + 1 < cliqueOffsets.size(); i++) {
+    Int cliqueSize = cliqueOffsets[i + 1] - cliqueOffsets[i];
+    for (Int j = cliqueOffsets[i]; j < cliqueOffsets[i + 1]; j++) {
+      offsets[denseIds[cliqueVertices[j]] + 1] += cliqueSize - 1;
+    }
+  }
+  for (Int u = 0; u < vertexCount; u++) {
+    offsets[u + 1] += offsets[u];
   }
+  adjacency = vector<Int>(offsets.back());
+  vector<Int> rowEnds(offsets.begin(), offsets.end() - 1);
+  for (Int i = 0; i + 1 < cliqueOffsets.size(); i++) {
+    for (Int j = cliqueOffsets[i]; j < cliqueOffsets[i + 1]; j++) {
+      Int u = denseIds[cliqueVertices[j]];
+      for (Int k = cliqueOffsets[i]; k < cliqueOffsets[i + 1]; k++) {
+        Int w = denseIds[cliqueVertices[k]];
+        if (w != u) { // a vertex may appear twice in a clique
+          adjacency[rowEnds[u]++] = w;
+        }
+      }
+    }
+  }
+
+  Int end = 0; // of compacted rows
+  for (Int u = 0; u < vertexCount; u++) {
+    auto rowBegin = adjacency.begin() + offsets[u];
+    auto rowEnd = adjacency.begin() + rowEnds[u];
+    sort(rowBegin, rowEnd);
+    rowEnd = unique(rowBegin, rowEnd);
+    offsets[u] = end;
+    end = move(rowBegin, rowEnd, adjacency.begin() + end) - adjacency.begin();
+  }
+  offsets[vertexCount] = end;
+  adjacency.resize(end);
+  adjacency.shrink_to_fit();
 }
 
-void Graph::addEdge(Int v1, Int v2) {
-  adjacencyMap.at(v1).insert(v2);
-  adjacencyMap.at(v2).insert(v1);
+Int Graph::getVertexCount() const {
+  return vertices.size();
 }
 
-bool Graph::isNeighbor(Int v1, Int v2) const {
-  return adjacencyMap.at(v1).contains(v2);
+std::span<const Int> Graph::getNeighbors(Int u) const {
+  return std::span<const Int>(adjacency.data() + offsets.at(u), adjacency.data() + offsets.at(u + 1));
 }
 
-bool Graph::hasPath(Int from, Int to, Set<Int>& visitedVertices) const {
-  if (from == to) {
-    return true;
+vector<Int> Graph::getMcsVertexOrder() const {
+  Int vertexCount = vertices.size();
+  vector<Int> vertexOrder;
+  if (vertexCount == 0) {
+    return vertexOrder;
   }
 
-  visitedVertices.insert(from);
+  vector<Int> rankedNeighborCounts(vertexCount); // dense id |-> number of ranked neighbors
+  vector<bool> ranked(vertexCount);
+  vector<vector<Int>> buckets(vertexCount); // ranked neighbor count |-> unranked vertices, with stale entries skipped when popped
+  for (Int u = vertexCount - 1; u >= 0; u--) { // smaller vertex is popped first
+    buckets.at(0).push_back(u);
+  }
 
-  Set<Int> unvisitedNeighbors = dpve::util::getDiff(adjacencyMap.at(from), visitedVertices);
+  Int maxCount = 0;
+  while (vertexOrder.size() < vertexCount) {
+    vector<Int>& bucket = buckets.at(maxCount);
+    if (bucket.empty()) {
+      maxCount--;
+      continue;
+    }
+    Int u = bucket.back();
+    bucket.pop_back();
+    if (ranked.at(u) || rankedNeighborCounts.at(u) != maxCount) {
+      continue;
+    }
 
-  for (Int v : unvisitedNeighbors) {
-    if (hasPath(v, to, visitedVertices)) {
-      return true;
+    ranked.at(u) = true;
+    vertexOrder.push_back(vertices.at(u));
+    for (Int neighbor : getNeighbors(u)) {
+      if (!ranked.at(neighbor)) {
+        Int count = ++rankedNeighborCounts.at(neighbor);
+        buckets.at(count).push_back(neighbor);
+        maxCount = max(maxCount, count);
+      }
     }
   }
-  return false;
+  return vertexOrder;
 }
 
-bool Graph::hasPath(Int from, Int to) const {
-  Set<Int> visitedVertices;
-  return hasPath(from, to, visitedVertices);
-}
+vector<Int> Graph::getLexPVertexOrder() const {
+  Int vertexCount = vertices.size();
 
-void Graph::removeVertex(Int v) {
-  vertices.erase(v);
+  /* unnumbered vertices with equal labels form a cell, which is a contiguous range of `sequence`: */
+  vector<Int> sequence(vertexCount); // index |-> dense id; numbered vertices first, then cells in descending label order
+  vector<Int> positions(vertexCount); // dense id |-> index in `sequence`
+  vector<Int> cells(vertexCount); // dense id |-> cell
+  vector<Int> cellStarts{0}; // cell |-> index in `sequence` of first unnumbered vertex
+  vector<Int> splitCells{-1}; // cell |-> cell split off in front of it during latest splitting step
+  vector<Int> splitSteps{-1}; // cell |-> latest splitting step
+  for (Int u = 0; u < vertexCount; u++) {
+    sequence.at(u) = u;
+    positions.at(u) = u;
+  }
 
-  adjacencyMap.erase(v); // edges from v
+  vector<Int> vertexOrder;
+  for (Int step = 0; step < vertexCount; step++) {
+    Int u = sequence.at(step); // first vertex of first nonempty cell, i.e. with max label
+    cellStarts.at(cells.at(u))++;
+    vertexOrder.push_back(vertices.at(u));
 
-  for (pair<const Int, Set<Int>>& vertexAndNeighbors : adjacencyMap) {
-    vertexAndNeighbors.second.erase(v); // edge to v
-  }
-}
+    for (Int neighbor : getNeighbors(u)) {
+      if (positions.at(neighbor) <= step) { // numbered
+        continue;
+      }
+      Int cell = cells.at(neighbor);
+      if (splitSteps.at(cell) != step) {
+        splitSteps.at(cell) = step;
+        splitCells.at(cell) = cellStarts.size();
+        cellStarts.push_back(cellStarts.at(cell));
+        splitCells.push_back(-1);
+        splitSteps.push_back(-1);
+      }
 
-void Graph::fillInEdges(Int v) {
-  const Set<Int>& neighbors = adjacencyMap.at(v);
-  for (auto neighbor1 = neighbors.begin(); neighbor1 != neighbors.end(); neighbor1++) {
-    for (auto neighbor2 = next(neighbor1); neighbor2 != neighbors.end(); neighbor2++) {
-      addEdge(*neighbor1, *neighbor2);
+      /* moves neighbor to front of its cell, then shrinks cell so that neighbor ends split cell: */
+      Int front = cellStarts.at(cell);
+      Int frontVertex = sequence.at(front);
+      sequence.at(positions.at(neighbor)) = frontVertex;
+      positions.at(frontVertex) = positions.at(neighbor);
+      sequence.at(front) = neighbor;
+      positions.at(neighbor) = front;
+      cellStarts.at(cell)++;
+      cells.at(neighbor) = splitCells.at(cell);
     }
   }
+  return vertexOrder;
 }
 
-Int Graph::getFillInEdgeCount(Int v) const {
-  Int edgeCount = 0;
-  const Set<Int>& neighbors = adjacencyMap.at(v);
-  for (auto neighbor1 = neighbors.begin(); neighbor1 != neighbors.end(); neighbor1++) {
-    for (auto neighbor2 = next(neighbor1); neighbor2 != neighbors.end(); neighbor2++) {
-      if (!isNeighbor(*neighbor1, *neighbor2)) {
-        edgeCount++;
+vector<Int> Graph::getLexMVertexOrder() const {
+  Int vertexCount = vertices.size();
+  LabelRanks labels(vertexCount);
+  vector<bool> numbered(vertexCount);
+  vector<Int> reachedSteps(vertexCount, -1); // dense id |-> latest step in which vertex was reached
+
+  vector<Int> vertexOrder;
+  for (Int step = 0; step < vertexCount; step++) {
+    Int v = -1;
+    for (Int u = 0; u < vertexCount; u++) {
+      if (!numbered.at(u) && (v < 0 || labels.at(u) > labels.at(v))) {
+        v = u;
       }
     }
+    numbered.at(v) = true;
+    reachedSteps.at(v) = step;
+    vertexOrder.push_back(vertices.at(v));
+
+    /* w gains current number iff some path from v to w has only unnumbered inner vertices, whose labels are less than w's: */
+    vector<vector<Int>> reached(labels.labelCount); // rank |-> reached vertices whose paths from v have max inner rank less than or equal to it
+    for (Int w : getNeighbors(v)) {
+      if (!numbered.at(w)) {
+        reachedSteps.at(w) = step;
+        reached.at(labels.getRank(w)).push_back(w);
+        labels.addNumber(w);
+      }
+    }
+    for (Int rank = 0; rank < labels.labelCount; rank++) {
+      while (!reached.at(rank).empty()) {
+        Int w = reached.at(rank).back();
+        reached.at(rank).pop_back();
+        for (Int z : getNeighbors(w)) {
+          if (numbered.at(z) || reachedSteps.at(z) == step) {
+            continue;
+          }
+          reachedSteps.at(z) = step;
+          if (labels.getRank(z) > rank) {
+            reached.at(labels.getRank(z)).push_back(z);
+            labels.addNumber(z);
+          }
+          else {
+            reached.at(rank).push_back(z);
+          }
+        }
+      }
+    }
+
+    labels.renumber(numbered);
   }
-  return edgeCount;
+  return vertexOrder;
 }
 
-Int Graph::getMinFillVertex() const {
-  Int vertex = dpve::MIN_INT;
-  Int fillInEdgeCount = dpve::MAX_INT;
+/* class InducedSubgraph ==================================================== */
 
+InducedSubgraph::InducedSubgraph(const Graph& graph, const vector<Int>& vertices, vector<Int>& localIds) : graph(graph), localIds(localIds) {
   for (Int v : vertices) {
-    Int edgeCount = getFillInEdgeCount(v);
-    if (edgeCount < fillInEdgeCount) {
-      fillInEdgeCount = edgeCount;
-      vertex = v;
+    Int u = graph.denseIds.at(v);
+    localIds.at(u) = denseIds.size();
+    denseIds.push_back(u);
+  }
+}
+
+InducedSubgraph::~InducedSubgraph() {
+  for (Int u : denseIds) {
+    localIds.at(u) = -1;
+  }
+}
+
+vector<Int> InducedSubgraph::getNeighbors(Int u) const {
+  vector<Int> neighbors;
+  for (Int neighbor : graph.getNeighbors(denseIds.at(u))) {
+    if (localIds.at(neighbor) >= 0) {
+      neighbors.push_back(localIds.at(neighbor));
     }
   }
+  return neighbors;
+}
 
-  if (vertex == dpve::MIN_INT) {
-    throw dpve::util::MyError("graph has no vertex");
+/* class FillGraph ========================================================== */
+
+FillGraph::FillGraph(const Graph& graph) {
+  vertices = graph.vertices;
+  neighbors = vector<vector<Int>>(vertices.size());
+  for (Int u = 0; u < vertices.size(); u++) {
+    std::span<const Int> uNeighbors = graph.getNeighbors(u);
+    neighbors.at(u).assign(uNeighbors.begin(), uNeighbors.end());
   }
+  fillInEdgeCounts = vector<Int>(vertices.size());
+  marks = vector<Int>(vertices.size());
+}
+
+void FillGraph::addEdge(Int u1, Int u2) {
+  neighbors.at(u1).push_back(u2);
+  neighbors.at(u2).push_back(u1);
+}
 
-  return vertex;
+void FillGraph::removeNeighbor(Int u, Int neighbor) {
+  vector<Int>& uNeighbors = neighbors.at(u);
+  auto it = find(uNeighbors.begin(), uNeighbors.end(), neighbor);
+  *it = uNeighbors.back();
+  uNeighbors.pop_back();
 }
 
-Graph Graph::projectOnto(Set<Int> vars) const{
-  Graph graph(vars);
-  for (auto& var1 : vars){
-    for (auto& var2: vars){
-      if (isNeighbor(var1,var2)){
-        graph.addEdge(var1,var2);
+void FillGraph::markNeighbors(Int u) {
+  stamp++;
+  for (Int neighbor : neighbors.at(u)) {
+    marks.at(neighbor) = stamp;
+  }
+}
+
+Int FillGraph::getFillInEdgeCount(Int u) {
+  markNeighbors(u);
+  Int adjacentPairCount = 0; // each adjacent pair of neighbors is counted twice
+  for (Int neighbor : neighbors.at(u)) {
+    for (Int w : neighbors.at(neighbor)) {
+      if (marks.at(w) == stamp) {
+        adjacentPairCount++;
       }
     }
   }
-  return graph;
+  Int degree = neighbors.at(u).size();
+  return degree * (degree - 1) / 2 - adjacentPairCount / 2;
 }
 
-/* class Label ============================================================== */
+vector<Int> FillGraph::getMinFillVertexOrder() {
+  std::set<pair<Int, Int>> queue; // (fill-in edge count, dense id), so that the first entry is the next vertex to eliminate
+  for (Int u = 0; u < vertices.size(); u++) {
+    fillInEdgeCounts.at(u) = getFillInEdgeCount(u);
+    queue.insert({fillInEdgeCounts.at(u), u});
+  }
+
+  auto updateFillInEdgeCount = [this, &queue](Int u, Int count) {
+    queue.erase({fillInEdgeCounts.at(u), u});
+    fillInEdgeCounts.at(u) = count;
+    queue.insert({count, u});
+  };
+
+  vector<bool> eliminatedNeighbors(vertices.size()); // neighbors of latest eliminated vertex
+  vector<Int> vertexOrder;
+  while (!queue.empty()) {
+    Int v = queue.begin()->second;
+    queue.erase(queue.begin());
+    vertexOrder.push_back(vertices.at(v));
+
+    vector<Int> vNeighbors;
+    vNeighbors.swap(neighbors.at(v));
+    for (Int neighbor : vNeighbors) {
+      removeNeighbor(neighbor, v);
+      eliminatedNeighbors.at(neighbor) = true;
+    }
 
-void Label::addNumber(Int i) {
-  push_back(i);
-  sort(begin(), end(), greater<Int>());
+    for (Int i = 0; i < vNeighbors.size(); i++) {
+      Int u1 = vNeighbors.at(i);
+      markNeighbors(u1);
+      for (Int j = i + 1; j < vNeighbors.size(); j++) {
+        Int u2 = vNeighbors.at(j);
+        if (marks.at(u2) == stamp) {
+          continue;
+        }
+        for (Int w : neighbors.at(u2)) { // common neighbors of u1 and u2 lose one fill-in edge
+          if (marks.at(w) == stamp && !eliminatedNeighbors.at(w)) {
+            updateFillInEdgeCount(w, fillInEdgeCounts.at(w) - 1);
+          }
+        }
+        addEdge(u1, u2);
+        marks.at(u2) = stamp; // keeps marks equal to neighbors of u1
+      }
+    }
+
+    for (Int neighbor : vNeighbors) { // neighborhoods changed
+      eliminatedNeighbors.at(neighbor) = false;
+      updateFillInEdgeCount(neighbor, getFillInEdgeCount(neighbor));
+    }
+  }
+  return vertexOrder;
+}
+
+/* class LabelRanks ========================================================= */
+
+LabelRanks::LabelRanks(Int vertexCount) : vector<Int>(vertexCount) {}
+
+Int LabelRanks::getRank(Int u) const {
+  return at(u) / 2;
 }
 
-bool Label::hasSmallerLabel(const pair<Int, Label>& a, const pair <Int, Label>& b) {
-  return a.second < b.second;
+void LabelRanks::addNumber(Int u) {
+  at(u)++;
 }
 
+void LabelRanks::renumber(const vector<bool>& numbered) {
+  vector<Int> newRanks(2 * labelCount, -1); // old doubled rank |-> new rank
+  for (Int u = 0; u < size(); u++) {
+    if (!numbered.at(u)) {
+      newRanks.at(at(u)) = 0;
+    }
+  }
+  labelCount = 0;
+  for (Int& newRank : newRanks) {
+    if (newRank == 0) {
+      newRank = labelCount++;
+    }
+  }
+  for (Int u = 0; u < size(); u++) {
+    if (!numbered.at(u)) {
+      at(u) = 2 * newRanks.at(at(u));
+    }
+  }
+  labelCount = max(labelCount, 1LL);
+}
@@ -1,30 +1,62 @@
 #pragma once
 #include "types.hpp"
+#include <span>
 #include <vector>
 using std::pair;
 using std::vector;
 namespace dpve{
-class Graph { // undirected
+class Graph { // undirected, in compressed sparse rows over dense vertex ids
 public:
-  Set<Int> vertices;
-  Map<Int, Set<Int>> adjacencyMap;
-
-  Graph(const Set<Int>& vs);
-  void addEdge(Int v1, Int v2);
-
-  bool isNeighbor(Int v1, Int v2) const;
-  bool hasPath(Int from, Int to, Set<Int>& visitedVertices) const; // path length >= 0
-  bool hasPath(Int from, Int to) const;
-  void removeVertex(Int v); // also removes edges from and to `v`
-  void fillInEdges(Int v); // does not remove `v`
-  Int getFillInEdgeCount(Int v) const;
-  Int getMinFillVertex() const;
-  Graph projectOnto(Set<Int> vars) const;
+  vector<Int> vertices; // dense id |-> vertex, ascending
+  vector<Int> denseIds; // vertex |-> dense id, or -1 for non-vertex; vertices are nonnegative
+  vector<Int> offsets; // dense id |-> index in `adjacency` of first neighbor; last entry is `adjacency.size()`
+  vector<Int> adjacency; // dense ids of neighbors, ascending for each vertex, without self-loops
+
+  Graph(); // no vertex
+  Graph(const vector<Int>& vertices, const vector<Int>& cliqueOffsets, const vector<Int>& cliqueVertices); // clique i is `cliqueVertices` from `cliqueOffsets` i to i + 1, not necessarily distinct
+  Int getVertexCount() const;
+  std::span<const Int> getNeighbors(Int u) const; // dense ids
+
+  vector<Int> getMcsVertexOrder() const; // maximum cardinality search with buckets
+  vector<Int> getLexPVertexOrder() const; // lexicographic BFS with partition refinement
+  vector<Int> getLexMVertexOrder() const; // Rose-Tarjan-Lueker LEX M
+};
+
+class InducedSubgraph { // view of subgraph induced by some vertices of a graph, over local ids
+public:
+  const Graph& graph;
+  vector<Int> denseIds; // local id |-> dense id in `graph`
+  vector<Int>& localIds; // dense id in `graph` |-> local id, or -1; scratch space shared by views of `graph`, restored by destructor
+
+  InducedSubgraph(const Graph& graph, const vector<Int>& vertices, vector<Int>& localIds);
+  ~InducedSubgraph();
+  vector<Int> getNeighbors(Int u) const; // local ids
 };
 
-class Label : public vector<Int> { // for lexicographic search
+class FillGraph { // elimination graph over dense vertex ids, for incremental min-fill
 public:
-  void addNumber(Int i); // retains descending order
-  static bool hasSmallerLabel(const pair<Int, Label>& a, const pair <Int, Label>& b);
+  vector<Int> vertices; // dense id |-> vertex, ascending
+  vector<vector<Int>> neighbors; // dense id |-> dense ids of uneliminated neighbors
+  vector<Int> fillInEdgeCounts; // dense id |-> number of non-adjacent neighbor pairs
+
+  vector<Int> marks; // dense id |-> stamp of latest marking
+  Int stamp = 0;
+
+  FillGraph(const Graph& graph);
+  void addEdge(Int u1, Int u2);
+  void removeNeighbor(Int u, Int neighbor);
+  void markNeighbors(Int u); // increments stamp
+  Int getFillInEdgeCount(Int u); // from scratch
+  vector<Int> getMinFillVertexOrder(); // eliminates all vertices, breaking ties by smaller vertex
+};
+
+class LabelRanks : public vector<Int> { // for lexicographic search: vertex |-> rank of label among unnumbered vertices, doubled
+public:
+  Int labelCount = 1; // distinct labels of unnumbered vertices
+
+  LabelRanks(Int vertexCount); // all labels empty
+  Int getRank(Int u) const; // rank of label before current step
+  void addNumber(Int u); // at most once per step, right between labels of equal and next greater rank
+  void renumber(const vector<bool>& numbered); // ends step, in linear time with counting sort
 };
-} //end namespace dpve
\ No newline at end of file
+} //end namespace dpve
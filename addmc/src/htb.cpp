@@ -0,0 +1,430 @@
+#include "htb.hpp"
+#include "io.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using std::cout;
+using std::lower_bound;
+using std::max;
+using std::min;
+using std::sort;
+
+namespace dpve{
+using util::MyError;
+using io::DASH_LINE;
+
+/* class JoinComponent ====================================================== */
+
+JoinNonterminal* JoinComponent::getComponentRoot() {
+  for (Int clusterIndex = 0; clusterIndex < restrictedVarOrder.size(); clusterIndex++) {
+    const vector<JoinNode*>& children = nodeClusters.at(clusterIndex);
+    if (!children.empty()) {
+      JoinNonterminal* node = new JoinNonterminal(children, projectableVarSets.at(clusterIndex));
+      Int target = getTargetClusterIndex(node, clusterIndex);
+      nodeClusters.at(target).push_back(node);
+    }
+  }
+
+  return new JoinNonterminal(nodeClusters.back());
+}
+
+Int JoinComponent::getNodeRank(const vector<Int>& nodeProjectableVars) const {
+  if (nodeProjectableVars.empty()) {
+    return restrictedVarOrder.size();
+  }
+
+  bool bucketElim = clusteringHeuristic == BUCKET_ELIM_LIST || clusteringHeuristic == BUCKET_ELIM_TREE; // min var rank, else max var rank
+  Int rankedVar = nodeProjectableVars.front();
+  for (Int var : nodeProjectableVars) {
+    if (bucketElim ? varRanks.at(var) < varRanks.at(rankedVar) : varRanks.at(var) > varRanks.at(rankedVar)) {
+      rankedVar = var;
+    }
+  }
+  return lower_bound(restrictedVarOrder.begin(), restrictedVarOrder.end(), rankedVar, [this](Int var1, Int var2) {
+    return varRanks.at(var1) < varRanks.at(var2);
+  }) - restrictedVarOrder.begin();
+}
+
+Int JoinComponent::getTargetClusterIndex(const JoinNode* node, Int clusterIndex) const {
+  bool listClustering = clusteringHeuristic == BUCKET_ELIM_LIST || clusteringHeuristic == BOUQUET_METHOD_LIST;
+  Int target = restrictedVarOrder.size(); // special cluster if no post-projection var is in Z
+  for (Int var : node->preProjectionVars) {
+    if (node->projectionVars.contains(var)) {
+      continue;
+    }
+    auto it = varClusterIndices.find(var);
+    if (it != varClusterIndices.end()) {
+      if (listClustering) {
+        return clusterIndex + 1;
+      }
+      if (it->second > clusterIndex) {
+        target = min(target, it->second);
+      }
+    }
+  }
+  return target;
+}
+
+JoinComponent::JoinComponent(const vector<Int>& varRanks, string clusteringHeuristic, const vector<JoinNode*>& subtrees, const Set<Int>& keptVars):
+  varRanks(varRanks), clusteringHeuristic(clusteringHeuristic) {
+  vector<vector<Int>> subtreeVars; // post-projection vars of each subtree that are in Z
+  for (const JoinNode* subtree : subtrees) {
+    vector<Int> vars;
+    for (Int var : subtree->preProjectionVars) {
+      if (!subtree->projectionVars.contains(var) && !keptVars.contains(var)) {
+        vars.push_back(var);
+        if (varClusterIndices.emplace(var, MIN_INT).second) {
+          restrictedVarOrder.push_back(var);
+        }
+      }
+    }
+    subtreeVars.push_back(vars);
+  }
+  sort(restrictedVarOrder.begin(), restrictedVarOrder.end(), [&varRanks](Int var1, Int var2) {
+    return varRanks.at(var1) < varRanks.at(var2);
+  }); // omega
+
+  nodeClusters = vector<vector<JoinNode*>>(restrictedVarOrder.size() + 1, vector<JoinNode*>());
+  for (Int i = 0; i < subtrees.size(); i++) {
+    Int nodeRank = getNodeRank(subtreeVars.at(i));
+    nodeClusters.at(nodeRank).push_back(subtrees.at(i));
+    for (Int var : subtreeVars.at(i)) { // var goes to Z_i of the last cluster containing var
+      Int& varClusterIndex = varClusterIndices.at(var);
+      varClusterIndex = max(varClusterIndex, nodeRank);
+    }
+  }
+
+  projectableVarSets = vector<Set<Int>>(restrictedVarOrder.size(), Set<Int>());
+  for (const auto& [var, clusterIndex] : varClusterIndices) {
+    projectableVarSets.at(clusterIndex).insert(var);
+  }
+}
+
+/* class JoinRootBuilder ==================================================== */
+
+void JoinRootBuilder::printInnerVarSets() const {
+  cout << "c inner vars: { ";
+  for (Int var : util::getSortedNums(innerVars)) {
+    cout << var << " ";
+  }
+  cout << "}\n";
+
+  for (Int clauseIndex = 0; clauseIndex < innerVarSets.size(); clauseIndex++) {
+    cout << "c inner vars of clause " << clauseIndex + 1 << ": {";
+    for (Int v : util::getSortedNums(innerVarSets.at(clauseIndex))) {
+      cout << " " << v;
+    }
+    cout << " }\n";
+  }
+}
+
+void JoinRootBuilder::printClauseGroups() const {
+  for (Int i = 0; i < clauseGroups.size(); i++) {
+    cout << "c clause group " << i + 1 << " contains these clause indices: {";
+    for (Int clauseIndex : clauseGroups.at(i)) {
+      cout << " " << clauseIndex + 1;
+    }
+    cout << " }\n";
+  }
+}
+
+void JoinRootBuilder::setInnerVarSets() {
+  innerVars = cnf.getInnerVars();
+  for (const Clause& clause : cnf.clauses) {
+    innerVarSets.push_back(util::getIntersection(clause.getClauseVars(), innerVars));
+  }
+}
+
+void JoinRootBuilder::setClauseGroups() {
+  vector<Int> varParents(cnf.declaredVarCount + 1); // disjoint sets of inner vars
+  for (Int var = 0; var < varParents.size(); var++) {
+    varParents.at(var) = var;
+  }
+  auto findRepresentative = [&varParents](Int var) {
+    while (varParents.at(var) != var) {
+      varParents.at(var) = varParents.at(varParents.at(var)); // path halving
+      var = varParents.at(var);
+    }
+    return var;
+  };
+
+  for (Int i = 0; i < innerVarSets.size(); i++) {
+    Int element = MIN_INT;
+    for (Int var : innerVarSets.at(i)) {
+      if (element != MIN_INT) {
+        varParents.at(findRepresentative(var)) = findRepresentative(element);
+      }
+      element = var;
+    }
+  }
+
+  Map<Int, vector<Int>> clauseMap; // representative var |-> clause indices
+
+  for (Int clauseIndex = 0; clauseIndex < innerVarSets.size(); clauseIndex++) {
+    const Set<Int>& innerVarSet = innerVarSets.at(clauseIndex);
+    if (innerVarSet.empty()) { // clause with no inner var
+      clauseGroups.push_back({clauseIndex});
+    }
+    else { // clause with inner var is put first in `clauseMap` then in `clauseGroups`
+      Int var = *innerVarSet.begin(); // arbitrary member
+      Int representative = findRepresentative(var);
+      if (clauseMap.contains(representative)) {
+        clauseMap.at(representative).push_back(clauseIndex);
+      }
+      else {
+        clauseMap[representative] = {clauseIndex};
+      }
+    }
+  }
+
+  for (const auto& [representative, clauseIndices] : clauseMap) { // adds to `clauseGroups` clauses with inner vars
+    if (verboseSolving >= 2) {
+      for (Int clauseIndex : clauseIndices) {
+        cout << "c var " << representative << " represents clause " << clauseIndex + 1 << "\n";
+      }
+    }
+    clauseGroups.push_back(clauseIndices);
+  }
+}
+
+JoinNonterminal* JoinRootBuilder::buildRoot(Int varOrderHeuristic, string clusteringHeuristic) const {
+  if (JoinNode::nodeCount != 0) {
+    throw MyError("join tree must be built from scratch (found ", JoinNode::nodeCount, " existing nodes)");
+  }
+
+  TimePoint varOrderStartPoint = util::getTimePoint();
+  vector<Int> varRanks(cnf.declaredVarCount + 1, MAX_INT); // computed once for all components
+  vector<Int> varOrder = cnf.getCnfVarOrder(varOrderHeuristic);
+  for (Int rank = 0; rank < varOrder.size(); rank++) {
+    varRanks.at(varOrder.at(rank)) = rank;
+  }
+  if (verboseSolving >= 1) {
+    io::printRow("varOrderSeconds", util::getDuration(varOrderStartPoint));
+  }
+
+  vector<JoinTerminal*> terminals;
+  for (Int clauseIndex = 0; clauseIndex < cnf.clauses.size(); clauseIndex++) {
+    terminals.push_back(new JoinTerminal(cnf)); // terminal index = clause index
+  }
+
+  vector<vector<JoinNode*>> leafBlocks;
+  for (const vector<Int>& clauseGroup : clauseGroups) {
+    vector<JoinNode*> leafBlock;
+    for (Int clauseIndex : clauseGroup) {
+      leafBlock.push_back(terminals.at(clauseIndex));
+    }
+    leafBlocks.push_back(leafBlock);
+  }
+
+  vector<JoinNode*> nonterminals;
+  for (Int i = 0; i < leafBlocks.size(); i++) {
+    if (verboseSolving >= 2) {
+      cout << "c building inner component " << i + 1 << ": started\n";
+    }
+    JoinComponent innerComponent(varRanks, clusteringHeuristic, leafBlocks.at(i), cnf.outerVars);
+    JoinNonterminal* innerRoot = innerComponent.getComponentRoot();
+    nonterminals.push_back(innerRoot);
+    if (verboseSolving >= 2) {
+      cout << "c building inner component " << i + 1 << ": ended\n";
+    }
+  }
+
+  if (verboseSolving >= 2) {
+    cout << "c building outer component: started\n";
+  }
+  JoinComponent outerComponent(varRanks, clusteringHeuristic, nonterminals, Set<Int>());
+  JoinNonterminal* outerRoot = outerComponent.getComponentRoot();
+  if (verboseSolving >= 2) {
+    cout << "c building outer component: ended\n";
+  }
+
+  return outerRoot;
+}
+
+JoinRootBuilder::JoinRootBuilder(const Cnf& cnf, Int verboseSolving): cnf(cnf), verboseSolving(verboseSolving) {
+  setInnerVarSets();
+  setClauseGroups();
+
+  if (verboseSolving >= 2) {
+    printClauseGroups();
+    printInnerVarSets();
+  }
+}
+
+/* class Planner ============================================================ */
+
+Planner* Planner::newPlanner(const Cnf& cnf, string clusteringHeuristic, Int clusterVarOrderHeuristic, Int verboseSolving) {
+  if (clusteringHeuristic == BUCKET_ELIM_LIST) {
+    return new BucketElimPlanner(cnf, false, clusterVarOrderHeuristic, verboseSolving);
+  }
+  if (clusteringHeuristic == BUCKET_ELIM_TREE) {
+    return new BucketElimPlanner(cnf, true, clusterVarOrderHeuristic, verboseSolving);
+  }
+  if (clusteringHeuristic == BOUQUET_METHOD_LIST) {
+    return new BouquetMethodPlanner(cnf, false, clusterVarOrderHeuristic, verboseSolving);
+  }
+  if (clusteringHeuristic == BOUQUET_METHOD_TREE) {
+    return new BouquetMethodPlanner(cnf, true, clusterVarOrderHeuristic, verboseSolving);
+  }
+  throw MyError("unknown clustering heuristic '", clusteringHeuristic, "'");
+}
+
+Float Planner::getSubtreeCost(const JoinNode* node) {
+  if (node->isTerminal()) {
+    return 0;
+  }
+  Float cost = 0;
+  for (const JoinNonterminal* nonterminal : static_cast<const JoinNonterminal*>(node)->getNonterminalPostOrder()) {
+    cost += std::exp2(static_cast<Float>(nonterminal->preProjectionVars.size())); // size of dense table over node vars
+  }
+  return cost;
+}
+
+bool Planner::hasLowerCost(const Planner* planner1, const Planner* planner2) {
+  if (planner1->width != planner2->width) {
+    return planner1->width < planner2->width;
+  }
+  return planner1->cost < planner2->cost;
+}
+
+void Planner::printJoinTree(const string& startWord) const {
+  cout << startWord << "p " << JOIN_TREE_WORD << " " << cnf.declaredVarCount << " " << terminalCount << " " << nodeCount << "\n";
+  joinRoot->printSubtree(startWord);
+}
+
+void Planner::printBinaryJoinTree() const {
+  string bytes;
+  joinRoot->encodeSubtree(bytes);
+  cout << "p " << BINARY_JOIN_TREE_WORD << " " << cnf.declaredVarCount << " " << terminalCount << " " << nodeCount << " " << bytes.size() << "\n";
+  cout.write(bytes.data(), bytes.size());
+  cout << "\n";
+}
+
+void Planner::outputJoinTree(bool binary) {
+  getJoinRoot();
+
+  cout << DASH_LINE;
+  if (binary) {
+    printBinaryJoinTree();
+  }
+  else {
+    printJoinTree();
+  }
+  cout << DASH_LINE;
+
+  cout << "c joinTreeWidth " << width << "\n"; // read by JoinTreeProcessor
+}
+
+JoinNonterminal* Planner::getJoinRoot() {
+  if (joinRoot == nullptr) {
+    TimePoint plannerStartPoint = util::getTimePoint();
+    JoinNode::resetStaticFields(); // node indices of this join tree start from 0
+    setJoinTree();
+    nodeCount = JoinNode::nodeCount;
+    terminalCount = JoinNode::terminalCount;
+    plannerDuration = util::getDuration(plannerStartPoint);
+
+    width = joinRoot->getWidth();
+    cost = getSubtreeCost(joinRoot);
+  }
+  return joinRoot;
+}
+
+void Planner::exportNodeCounts() const {
+  JoinNode::nodeCount = nodeCount;
+  JoinNode::terminalCount = terminalCount;
+}
+
+Planner::Planner(const Cnf& cnf, string clusteringHeuristic, Int clusterVarOrderHeuristic, Int verboseSolving):
+  cnf(cnf), verboseSolving(verboseSolving), clusteringHeuristic(clusteringHeuristic), clusterVarOrderHeuristic(clusterVarOrderHeuristic) {}
+
+/* class BucketElimPlanner ================================================== */
+
+void BucketElimPlanner::setJoinTree() {
+  joinRoot = JoinRootBuilder(cnf, verboseSolving).buildRoot(clusterVarOrderHeuristic, clusteringHeuristic);
+}
+
+BucketElimPlanner::BucketElimPlanner(const Cnf& cnf, bool treeClustering, Int clusterVarOrderHeuristic, Int verboseSolving):
+  Planner(cnf, treeClustering ? BUCKET_ELIM_TREE : BUCKET_ELIM_LIST, clusterVarOrderHeuristic, verboseSolving) {}
+
+/* class BouquetMethodPlanner =============================================== */
+
+void BouquetMethodPlanner::setJoinTree() {
+  joinRoot = JoinRootBuilder(cnf, verboseSolving).buildRoot(clusterVarOrderHeuristic, clusteringHeuristic);
+}
+
+BouquetMethodPlanner::BouquetMethodPlanner(const Cnf& cnf, bool treeClustering, Int clusterVarOrderHeuristic, Int verboseSolving):
+  Planner(cnf, treeClustering ? BOUQUET_METHOD_TREE : BOUQUET_METHOD_LIST, clusterVarOrderHeuristic, verboseSolving) {}
+
+/* class PortfolioPlanner =================================================== */
+
+void PortfolioPlanner::plan() {
+  std::atomic<Int> nextPlannerIndex = 0;
+  auto planRemaining = [this, &nextPlannerIndex]() {
+    for (Int i = nextPlannerIndex++; i < planners.size(); i = nextPlannerIndex++) {
+      planners.at(i)->getJoinRoot();
+    }
+  };
+
+  vector<std::thread> threads;
+  for (Int i = 1; i < std::min<Int>(threadCount, planners.size()); i++) {
+    threads.emplace_back(planRemaining);
+  }
+  planRemaining();
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  std::stable_sort(planners.begin(), planners.end(), Planner::hasLowerCost);
+
+  if (verboseSolving >= 1) {
+    for (const Planner* planner : planners) {
+      cout << "c portfolio member " << planner->clusteringHeuristic << " " << planner->clusterVarOrderHeuristic
+        << ": width " << planner->width << ", cost " << planner->cost << ", seconds " << planner->plannerDuration << "\n";
+    }
+  }
+}
+
+void PortfolioPlanner::outputJoinTrees(bool binary) {
+  plan();
+  for (Planner* planner : planners) {
+    cout << "c clusteringHeuristic " << planner->clusteringHeuristic << "\n";
+    cout << "c clusterVarOrderHeuristic " << planner->clusterVarOrderHeuristic << "\n";
+    planner->outputJoinTree(binary);
+    cout << "c seconds " << planner->plannerDuration << "\n"; // read by JoinTreeProcessor
+    cout << "=\n"; // tree separator
+  }
+}
+
+Planner* PortfolioPlanner::getBestPlanner() {
+  if (planners.front()->joinRoot == nullptr) {
+    plan();
+  }
+  Planner* bestPlanner = planners.front();
+  bestPlanner->exportNodeCounts();
+  return bestPlanner;
+}
+
+PortfolioPlanner::PortfolioPlanner(const Cnf& cnf, const vector<string>& clusteringHeuristics, const vector<Int>& clusterVarOrderHeuristics, Int threadCount, Int verboseSolving):
+  threadCount(threadCount), verboseSolving(verboseSolving) {
+  if (clusteringHeuristics.empty() || clusterVarOrderHeuristics.empty()) {
+    throw MyError("portfolio must have at least one clustering heuristic and one cluster var order");
+  }
+  Int plannerVerbosity = threadCount > 1 ? 0 : verboseSolving; // keeps concurrent planner output from interleaving
+  for (Int clusterVarOrderHeuristic : clusterVarOrderHeuristics) {
+    for (const string& clusteringHeuristic : clusteringHeuristics) {
+      planners.push_back(Planner::newPlanner(cnf, clusteringHeuristic, clusterVarOrderHeuristic, plannerVerbosity));
+    }
+  }
+}
+
+PortfolioPlanner::~PortfolioPlanner() {
+  for (Planner* planner : planners) {
+    delete planner;
+  }
+}
+} //end namespace dpve
@@ -0,0 +1,121 @@
+#pragma once
+
+/* inclusions =============================================================== */
+
+#include "common.hpp"
+#include "formula.hpp"
+#include "jointrees.hpp"
+
+/* classes for planning ===================================================== */
+
+namespace dpve{
+class JoinComponent { // for projected counting
+public:
+  const vector<Int>& varRanks; // var |-> rank in cluster var order, shared by all components
+  const string clusteringHeuristic;
+
+  vector<Int> restrictedVarOrder; // Z sorted by var rank
+  Map<Int, Int> varClusterIndices; // var in Z |-> i such that var is in Z_i
+  vector<Set<Int>> projectableVarSets; // {Z_1, ..., Z_m} is a partition of Z
+  vector<vector<JoinNode*>> nodeClusters; // kappa_0, ..., kappa_m; kappa_0 is nodeClusters.back()
+
+  JoinNonterminal* getComponentRoot();
+  Int getNodeRank(const vector<Int>& nodeProjectableVars) const; // index into restrictedVarOrder or m if there is no var
+  Int getTargetClusterIndex(const JoinNode* node, Int clusterIndex) const; // replaces JoinNode::chooseClusterIndex
+
+  JoinComponent(
+    const vector<Int>& varRanks,
+    string clusteringHeuristic,
+    const vector<JoinNode*>& subtrees, // R
+    const Set<Int>& keptVars // F
+  );
+};
+
+class JoinRootBuilder {
+public:
+  const Cnf& cnf;
+  const Int verboseSolving;
+
+  Set<Int> innerVars;
+  vector<Set<Int>> innerVarSets; // clause index |-> vars
+  vector<vector<Int>> clauseGroups; // group |-> clause indices
+
+  void printInnerVarSets() const;
+  void printClauseGroups() const;
+
+  void setInnerVarSets(); // also sets innerVars
+  void setClauseGroups();
+
+  JoinNonterminal* buildRoot(Int varOrderHeuristic, string clusteringHeuristic) const;
+
+  JoinRootBuilder(const Cnf& cnf, Int verboseSolving = 0);
+};
+
+class Planner { // abstract
+public:
+  const Cnf& cnf;
+  const Int verboseSolving;
+
+  JoinNonterminal* joinRoot = nullptr;
+  Float plannerDuration = 0; // in seconds
+  Int width = MIN_INT; // of join tree
+  Float cost = 0; // sum of 2^|vars| over nonterminal nodes, for breaking ties in width
+
+  /* JoinNode counters are per thread, so they are recorded with the join tree: */
+  Int nodeCount = 0;
+  Int terminalCount = 0;
+
+  const string clusteringHeuristic;
+  const Int clusterVarOrderHeuristic;
+
+  static Planner* newPlanner(const Cnf& cnf, string clusteringHeuristic, Int clusterVarOrderHeuristic, Int verboseSolving = 0);
+  static Float getSubtreeCost(const JoinNode* node);
+  static bool hasLowerCost(const Planner* planner1, const Planner* planner2); // width first then cost
+
+  void printJoinTree(const string& startWord = "") const; // in planner-executor format
+  void printBinaryJoinTree() const; // problem line then varint nonterminals, for DMC
+  void outputJoinTree(bool binary = false); // for HTB executable
+  JoinNonterminal* getJoinRoot(); // plans once then reuses join tree (for in-process executor)
+  void exportNodeCounts() const; // sets JoinNode counters of calling thread (for executor after concurrent planning)
+
+  virtual void setJoinTree() = 0;
+
+  Planner(const Cnf& cnf, string clusteringHeuristic, Int clusterVarOrderHeuristic, Int verboseSolving);
+  virtual ~Planner() = default;
+};
+
+class BucketElimPlanner : public Planner {
+public:
+  void setJoinTree() override;
+
+  BucketElimPlanner(const Cnf& cnf, bool treeClustering, Int clusterVarOrderHeuristic, Int verboseSolving = 0);
+};
+
+class BouquetMethodPlanner : public Planner { // Bouquet's Method
+public:
+  void setJoinTree() override;
+
+  BouquetMethodPlanner(const Cnf& cnf, bool treeClustering, Int clusterVarOrderHeuristic, Int verboseSolving = 0);
+};
+
+class PortfolioPlanner { // plans with every combination of clustering heuristic and cluster var order
+public:
+  const Int threadCount;
+  const Int verboseSolving;
+
+  vector<Planner*> planners; // in ascending cost after planning
+
+  void plan(); // builds all join trees concurrently then sorts planners
+  void outputJoinTrees(bool binary = false); // for HTB executable, streams join trees in ascending cost
+  Planner* getBestPlanner();
+
+  PortfolioPlanner(
+    const Cnf& cnf,
+    const vector<string>& clusteringHeuristics,
+    const vector<Int>& clusterVarOrderHeuristics,
+    Int threadCount,
+    Int verboseSolving = 0
+  );
+  ~PortfolioPlanner();
+};
+} //end namespace dpve
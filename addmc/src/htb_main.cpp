@@ -0,0 +1,141 @@
+#include "htb.hpp"
+#include "io.hpp"
+#include "util.hpp"
+
+#include "../../addmc/libraries/cxxopts/include/cxxopts.hpp"
+
+#include <thread>
+#include <unistd.h>
+
+using dpve::Cnf;
+using dpve::Int;
+using dpve::JoinTree;
+using dpve::Planner;
+using dpve::PortfolioPlanner;
+using dpve::TimePoint;
+using dpve::io::printRow;
+using dpve::util::getDuration;
+using dpve::util::getTimePoint;
+using std::cout;
+using std::to_string;
+
+namespace {
+  const string BINARY_JOIN_TREE_FLAG = "bj";
+  const string CNF_FILE_FLAG = "cf";
+  const string CLUSTERING_HEURISTIC_FLAG = "ch";
+  const string CLUSTER_VAR_FLAG = "cv";
+  const string HELP_FLAG = "h";
+  const string JOIN_TREE_CACHE_FLAG = "jc";
+  const string PROJECTED_COUNTING_FLAG = "pc";
+  const string PORTFOLIO_FLAG = "pf";
+  const string RANDOM_SEED_FLAG = "rs";
+  const string THREAD_COUNT_FLAG = "tc";
+  const string VERBOSE_CNF_FLAG = "vc";
+  const string VERBOSE_SOLVING_FLAG = "vs";
+
+  void cacheJoinTree(const string& joinTreeCacheDir, const Cnf& cnf, Planner* planner) { // so that DMC runs on same formula skip planning
+    JoinTree joinTree(planner->getJoinRoot(), cnf.declaredVarCount, planner->terminalCount, planner->nodeCount, cnf);
+    joinTree.width = planner->width;
+    joinTree.plannerDuration = planner->plannerDuration;
+    dpve::JoinTreeCache(joinTreeCacheDir, cnf).storeJoinTree(joinTree);
+  }
+}
+
+int main(int argc, char** argv) {
+  cout << std::unitbuf; // enables automatic flushing
+
+  cxxopts::Options options("htb", "Heuristic Tree Builder");
+  options.set_width(118);
+
+  using cxxopts::value;
+  options.add_options()
+    (CNF_FILE_FLAG, "CNF file path; string (required)", value<string>())
+    (PROJECTED_COUNTING_FLAG, "projected counting (graded join tree): 0, 1; int", value<Int>()->default_value("0"))
+    (RANDOM_SEED_FLAG, "random seed; int", value<Int>()->default_value("0"))
+    (CLUSTER_VAR_FLAG, dpve::io::helpClusterVarOrderHeuristic(), value<Int>()->default_value(to_string(dpve::LEX_P_HEURISTIC)))
+    (CLUSTERING_HEURISTIC_FLAG, dpve::io::helpClusteringHeuristic(), value<string>()->default_value(dpve::BOUQUET_METHOD_TREE))
+    (PORTFOLIO_FLAG, "portfolio of all clustering heuristics and cluster var orders, join trees printed in ascending width (ignores " + CLUSTERING_HEURISTIC_FLAG + "_arg and " + CLUSTER_VAR_FLAG + "_arg): 0, 1; int", value<Int>()->default_value("0"))
+    (THREAD_COUNT_FLAG, "thread count for portfolio [or 0 for hardware_concurrency value]; int", value<Int>()->default_value("1"))
+    (BINARY_JOIN_TREE_FLAG, "binary join trees (compact varint format read by DMC): 0, 1; int", value<Int>()->default_value("0"))
+    (JOIN_TREE_CACHE_FLAG, "join tree cache directory: best join tree replaces cached one of same formula if narrower [or \"\" for no cache]; string", value<string>()->default_value(""))
+    (VERBOSE_CNF_FLAG, dpve::io::helpVerboseCnfProcessing(), value<Int>()->default_value("0"))
+    (VERBOSE_SOLVING_FLAG, dpve::io::helpVerboseSolving(), value<Int>()->default_value("0"))
+    (HELP_FLAG, "help")
+  ;
+
+  cxxopts::ParseResult result = options.parse(argc, argv);
+  if (result.count(HELP_FLAG) || !result.count(CNF_FILE_FLAG)) {
+    cout << options.help();
+    return 0;
+  }
+
+  cout << "c htb process:\n";
+  cout << "c pid " << getpid() << "\n\n"; // read by JoinTreeProcessor
+
+  TimePoint toolStartPoint = getTimePoint();
+
+  auto cnfFilePath = result[CNF_FILE_FLAG].as<string>();
+  auto projectedCounting = result[PROJECTED_COUNTING_FLAG].as<Int>();
+  auto randomSeed = result[RANDOM_SEED_FLAG].as<Int>();
+  auto clusterVarOrderHeuristic = result[CLUSTER_VAR_FLAG].as<Int>();
+  assert(dpve::CNF_VAR_ORDER_HEURISTICS.contains(abs(clusterVarOrderHeuristic)));
+  auto clusteringHeuristic = result[CLUSTERING_HEURISTIC_FLAG].as<string>();
+  assert(dpve::CLUSTERING_HEURISTICS.contains(clusteringHeuristic));
+  auto portfolio = result[PORTFOLIO_FLAG].as<Int>();
+  auto threadCount = result[THREAD_COUNT_FLAG].as<Int>();
+  if (threadCount <= 0) {
+    threadCount = std::thread::hardware_concurrency();
+  }
+  auto binaryJoinTree = result[BINARY_JOIN_TREE_FLAG].as<Int>();
+  auto joinTreeCacheDir = result[JOIN_TREE_CACHE_FLAG].as<string>();
+  auto verboseCnf = result[VERBOSE_CNF_FLAG].as<Int>();
+  auto verboseSolving = result[VERBOSE_SOLVING_FLAG].as<Int>();
+
+  if (verboseSolving >= 1) {
+    cout << "c processing command-line options...\n";
+    printRow("cnfFile", cnfFilePath);
+    printRow("projectedCounting", projectedCounting);
+    printRow("randomSeed", randomSeed);
+    printRow("binaryJoinTree", binaryJoinTree);
+    if (!joinTreeCacheDir.empty()) {
+      printRow("joinTreeCacheDir", joinTreeCacheDir);
+    }
+    if (portfolio) {
+      printRow("portfolio", portfolio);
+      printRow("threadCount", threadCount);
+    }
+    else {
+      printRow("clusterVarOrderHeuristic", (clusterVarOrderHeuristic < 0 ? "INVERSE_" : "") + dpve::CNF_VAR_ORDER_HEURISTICS.at(abs(clusterVarOrderHeuristic)));
+      printRow("clusteringHeuristic", dpve::CLUSTERING_HEURISTICS.at(clusteringHeuristic));
+    }
+    cout << "\n";
+  }
+
+  try {
+    Cnf cnf(verboseCnf, randomSeed, false, projectedCounting);
+    cnf.readCnfFile(cnfFilePath);
+    cout << "c computing output...\n";
+    if (portfolio) {
+      vector<string> clusteringHeuristics;
+      for (const auto& [heuristic, name] : dpve::CLUSTERING_HEURISTICS) {
+        clusteringHeuristics.push_back(heuristic);
+      }
+      PortfolioPlanner portfolioPlanner(cnf, clusteringHeuristics, dpve::PORTFOLIO_VAR_ORDER_HEURISTICS, threadCount, verboseSolving);
+      portfolioPlanner.outputJoinTrees(binaryJoinTree);
+      if (!joinTreeCacheDir.empty()) {
+        cacheJoinTree(joinTreeCacheDir, cnf, portfolioPlanner.getBestPlanner());
+      }
+    }
+    else {
+      Planner* planner = Planner::newPlanner(cnf, clusteringHeuristic, clusterVarOrderHeuristic, verboseSolving);
+      planner->outputJoinTree(binaryJoinTree);
+      if (!joinTreeCacheDir.empty()) {
+        cacheJoinTree(joinTreeCacheDir, cnf, planner);
+      }
+      delete planner;
+    }
+  }
+  catch (dpve::util::EmptyClauseException) {}
+
+  cout << "c seconds " << getDuration(toolStartPoint) << "\n"; // read by JoinTreeProcessor
+}
@@ -3,9 +3,11 @@
 
 #include "../../addmc/libraries/cxxopts/include/cxxopts.hpp"
 #include "formula.hpp"
+#include "preprocessor.hpp"
 #include "util.hpp"
 
 #include <cmath>
+#include <fstream>
 #include <iomanip>
 #include <thread>
 
@@ -26,31 +28,48 @@ using std::thread;
 namespace {  // anonymous namespace. Local to this file
 
   const string ATOMIC_ABSTRACT_FLAG = "aa";
+  const string AUTOTUNE_FLAG = "at";
   const string CNF_FILE_FLAG = "cf";
+  const string CLUSTERING_HEURISTIC_FLAG = "ch";
+  const string CHECKPOINT_INTERVAL_FLAG = "ci";
+  const string CHECKPOINT_DIR_FLAG = "ck";
+  const string CLUSTER_VAR_FLAG = "cv";
   const string DD_PACKAGE_FLAG = "dp";
   const string DD_VAR_FLAG = "dv";
+  const string DIAGRAM_CACHE_FLAG = "dc";
+  const string DIAGRAM_CACHE_SECONDS_FLAG = "ds";
   const string DYN_ORDER_FLAG = "dy";
   const string EXIST_RANDOM_FLAG = "er";
   const string INIT_RATIO_FLAG = "ir";
   const string HELP_FLAG = "h";
+  const string HARDWARE_COUNTERS_FLAG = "hc";
+  const string JOIN_TREE_CACHE_FLAG = "jc";
   const string JOIN_PRIORITY_FLAG = "jp";
   const string LOG_BOUND_FLAG = "lb";
   const string LOG_COUNTING_FLAG = "lc";
   const string MAXIMIZER_FORMAT_FLAG = "mf";
+  const string MEM_LIMIT_FLAG = "ml";
   const string MAX_MEM_FLAG = "mm";
   const string MULTIPLE_PRECISION_FLAG = "mp";
   const string MEM_SENSITIVITY_FLAG = "ms";
   const string MAXIMIZER_VERIFICATION_FLAG = "mv";
   const string PROJECTED_COUNTING_FLAG = "pc";
+  const string PREPROCESS_FLAG = "pp";
   const string PLANNER_WAIT_FLAG = "pw";
+  const string REORDER_BUDGET_FLAG = "rb";
+  const string RESUME_FLAG = "re";
+  const string REPORT_FILE_FLAG = "rf";
   const string RANDOM_SEED_FLAG = "rs";
   const string SAT_FILTER_FLAG = "sa";
+  const string STATUS_FILE_FLAG = "sf";
+  const string STATUS_INTERVAL_FLAG = "si";
   const string SCALING_FACTOR_FLAG = "sc";
   const string SUBSTITUTION_MAXIMIZATION_FLAG = "sm";
   const string SAT_SOLVER_PRUNING = "sp";
   const string SLICE_VAR_FLAG = "sv";
   const string THREAD_COUNT_FLAG = "tc";
   const string THRESHOLD_MODEL_FLAG = "tm";
+  const string TRACE_FILE_FLAG = "tf";
   const string TABLE_RATIO_FLAG = "tr";
   const string THREAD_SLICE_COUNT_FLAG = "ts";
   const string VERBOSE_CNF_FLAG = "vc";
@@ -188,14 +207,6 @@ namespace {  // anonymous namespace. Local to this file
     return s + " (negatives for inverse orders); int";
   }
 
-  string helpVerboseCnfProcessing() {
-    return "verbose CNF processing: 0, 1, 2, 3; int";
-  }
-
-  string helpVerboseSolving() {
-    return "verbose solving: 0, 1, 2; int";
-  }
-
   string helpDiagramVarOrderHeuristic() {
     return "diagram var order" + helpVarOrderHeuristic(dpve::CNF_VAR_ORDER_HEURISTICS);
   }
@@ -218,6 +229,24 @@ namespace {  // anonymous namespace. Local to this file
     return s + "; string";
   }
 
+  string helpDiagramCache() {
+    string s = "subtree diagram cache directory";
+    s += requireOptions({
+      OptionRequirement(EXIST_RANDOM_FLAG, "0"),
+      OptionRequirement(SAT_FILTER_FLAG, "0")
+    });
+    return s + ": diagrams of cached join subtrees are loaded instead of solved [or \"\" for no cache]; string";
+  }
+
+  string helpCheckpointDir() {
+    string s = "checkpoint directory for executor progress";
+    s += requireOptions({
+      OptionRequirement(SAT_FILTER_FLAG, "0"),
+      OptionRequirement(MAXIMIZER_FORMAT_FLAG, to_string(dpve::NEITHER_FORMAT))
+    });
+    return s + ": executor state is saved periodically for resuming [or \"\" for no checkpoints]; string";
+  }
+
   string helpDynamicVarOrdering() {
     return "dynamic variable ordering. DD_PACKAGE must be CUDD. 0/1. Default 0.";
   }
@@ -235,6 +264,29 @@ namespace {  // anonymous namespace. Local to this file
   }
 }
 
+string dpve::io::helpVerboseCnfProcessing() {
+  return "verbose CNF processing: 0, 1, 2, 3; int";
+}
+
+string dpve::io::helpVerboseSolving() {
+  return "verbose solving: 0, 1, 2; int";
+}
+
+string dpve::io::helpClusterVarOrderHeuristic() {
+  return "cluster var order" + helpVarOrderHeuristic(CNF_VAR_ORDER_HEURISTICS);
+}
+
+string dpve::io::helpClusteringHeuristic() {
+  string s = "clustering heuristic: ";
+  for (auto it = CLUSTERING_HEURISTICS.begin(); it != CLUSTERING_HEURISTICS.end(); it++) {
+    s += it->first + "/" + it->second;
+    if (next(it) != CLUSTERING_HEURISTICS.end()) {
+      s += ", ";
+    }
+  }
+  return s + "; string";
+}
+
 void dpve::io::printPreamble(int argc, char** argv){
    printLine("name of program: "+string(argv[0])+"\n") ;
    printLine("there are "+to_string(argc-1)+" (more) arguments, they are:  "," ") ;
@@ -246,6 +298,70 @@ void dpve::io::printInputLine(const string& line, Int lineIndex) {
   cout << "c o line " << right << setw(5) << lineIndex << ":" << (line.empty() ? "" : " " + line) << "\n";
 }
 
+/* class Report ============================================================= */
+
+string dpve::io::Report::filePath;
+std::map<string, std::map<string, string>> dpve::io::Report::sections;
+std::mutex dpve::io::Report::mutex;
+std::atomic<bool> dpve::io::Report::opened = false;
+
+bool dpve::io::Report::isOpen() {
+  return opened;
+}
+
+void dpve::io::Report::open(const string& filePath) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Report::filePath = filePath;
+  opened = true;
+}
+
+void dpve::io::Report::add(const string& section, const string& key, const string& val) {
+  if (!isOpen()) {
+    return;
+  }
+  string quoted = "\"";
+  for (char c : val) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    if (static_cast<unsigned char>(c) < 0x20) { // control character
+      char escaped[7];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+      continue;
+    }
+    quoted += c;
+  }
+  addJson(section, key, quoted + "\"");
+}
+
+void dpve::io::Report::addJson(const string& section, const string& key, const string& json) {
+  std::lock_guard<std::mutex> lock(mutex);
+  sections[section][key] = json;
+}
+
+void dpve::io::Report::close() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!opened) {
+    return;
+  }
+  opened = false; // also if writing fails, so that it is not retried
+  std::ofstream file(filePath);
+  file << "{";
+  for (auto section = sections.begin(); section != sections.end(); section++) {
+    file << (section == sections.begin() ? "\n" : ",\n") << "  \"" << section->first << "\": {";
+    for (auto field = section->second.begin(); field != section->second.end(); field++) {
+      file << (field == section->second.begin() ? "\n" : ",\n") << "    \"" << field->first << "\": " << field->second;
+    }
+    file << "\n  }";
+  }
+  file << "\n}\n";
+  if (!file) {
+    throw util::MyError("unable to write report file ", filePath);
+  }
+  filePath.clear();
+}
+
 void dpve::io::printRowKey(const string& key, size_t keyWidth) {
   string prefix = key;
   if (key == "s"){ //s SATISFIABLE
@@ -355,6 +471,18 @@ void dpve::io::printAdjustedSolutionRows(const Number& adjustedSolution, bool sa
     printDoubleRow(adjustedSolution, keyWidth, logCounting);
   }
   cout << DASH_LINE;
+
+  if (Report::isOpen()) { // every numeric format, under the same keys whatever the options
+    Report::add("solution", "unsatisfiable", unsatFlag);
+    Report::add("solution", "log10Estimate", logCounting ? adjustedSolution.fraction : adjustedSolution.getLog10());
+    if (multiplePrecision) {
+      Report::add("solution", "double", adjustedSolution.quotient.get_d());
+      Report::add("solution", "exactFraction", adjustedSolution.quotient.get_str());
+    }
+    else {
+      Report::add("solution", "double", logCounting ? exp10l(adjustedSolution.fraction) : adjustedSolution.fraction);
+    }
+  }
 }
 
 void dpve::io::printAssignmentString(string s){
@@ -381,33 +509,51 @@ PruneMaxParams::PruneMaxParams(const Float logBound, const Int maximizerFormat,
       substitutionMaximization(substitutionMaximization), thresholdModel(thresholdModel)
         {}
 
-InputParams::InputParams(const bool atomicAbstract, const Cnf cnf, const string ddPackage, 
-    const Int ddVarOrderHeuristic, const Int dynVarOrdering, const bool existRandom, const Int initRatio, const string joinPriority, const bool logCounting,
-    const bool multiplePrecision, const Float maxMem, const Float plannerWaitDuration, 
-    const bool projectedCounting, const PruneMaxParams pmParams, const Int randomSeed, const Int satFilter, const Float scalingFactor,
-    const Int tableRatio, const Int threadCount, const TimePoint toolStartPoint, 
+InputParams::InputParams(const bool atomicAbstract, const Int autotuneSubtrees, const string checkpointDir, const Float checkpointSeconds, const string clusteringHeuristic, const Int clusterVarOrderHeuristic, const Cnf cnf, const string ddPackage, 
+    const Int ddVarOrderHeuristic, const string diagramCacheDir, const Float diagramCacheSeconds, const Int dynVarOrdering, const bool existRandom, const bool hardwareCounters, const Int initRatio, 
+    const string joinPriority, const string joinTreeCacheDir, const bool logCounting,
+    const bool multiplePrecision, const Float maxMem, const Float memLimit, const Float plannerWaitDuration, const bool preprocessing, 
+    const bool projectedCounting, const PruneMaxParams pmParams, const Int randomSeed, const Float reorderBudget, const string reportFile, const bool resume, const Int satFilter, const string statusFile, const Float statusSeconds, const Float scalingFactor,
+    const Int tableRatio, const Int threadCount, const TimePoint toolStartPoint, const string traceFile,
     const Int verboseCnf, const Int verboseJoinTree, const Int verboseProfiling, const Int verboseSolving, const bool weightedCounting):
     
     atomicAbstract(atomicAbstract),
+    autotuneSubtrees(autotuneSubtrees),
+    checkpointDir(checkpointDir),
+    checkpointSeconds(checkpointSeconds),
+    clusteringHeuristic(clusteringHeuristic),
+    clusterVarOrderHeuristic(clusterVarOrderHeuristic),
     cnf(cnf),
     ddPackage(ddPackage),
     ddVarOrderHeuristic(ddVarOrderHeuristic),
+    diagramCacheDir(diagramCacheDir),
+    diagramCacheSeconds(diagramCacheSeconds),
     dynVarOrdering(dynVarOrdering),
     initRatio(initRatio),
     joinPriority(joinPriority),
+    joinTreeCacheDir(joinTreeCacheDir),
     multiplePrecision(multiplePrecision),
     maxMem(maxMem),
+    memLimit(memLimit),
     plannerWaitDuration(plannerWaitDuration),
+    preprocessing(preprocessing),
     existRandom(existRandom),
+    hardwareCounters(hardwareCounters),
     logCounting(logCounting),
     projectedCounting(projectedCounting),
     pmParams(pmParams),
     randomSeed(randomSeed),
+    reorderBudget(reorderBudget),
+    reportFile(reportFile),
+    resume(resume),
     satFilter(satFilter),
+    statusFile(statusFile),
+    statusSeconds(statusSeconds),
     scalingFactor(scalingFactor),
     tableRatio(tableRatio),
     threadCount(threadCount),
     toolStartPoint(toolStartPoint),
+    traceFile(traceFile),
     verboseCnf(verboseCnf),
     verboseJoinTree(verboseJoinTree),
     verboseProfiling(verboseProfiling),
@@ -418,7 +564,7 @@ InputParams::InputParams(const bool atomicAbstract, const Cnf cnf, const string
 const InputParams dpve::io::parseOptions(int argc, char** argv) {
   // print all command line arguments
    
-  cxxopts::Options options("dmc", "Diagram Model Counter (reads join tree from stdin)");
+  cxxopts::Options options("dmc", "Diagram Model Counter (reads join tree from stdin unless " + CLUSTERING_HEURISTIC_FLAG + "_arg is given)");
   options.set_width(118);
 
   using cxxopts::value;
@@ -435,19 +581,36 @@ const InputParams dpve::io::parseOptions(int argc, char** argv) {
     (MAXIMIZER_FORMAT_FLAG, helpMaximizerFormat(), value<Int>()->default_value(to_string(NEITHER_FORMAT)))
     (MAXIMIZER_VERIFICATION_FLAG, "maximizer verification" + requireOption(MAXIMIZER_FORMAT_FLAG, to_string(NEITHER_FORMAT), ">") + ": 0, 1; int", value<Int>()->default_value("0"))
     (SUBSTITUTION_MAXIMIZATION_FLAG, helpSubstitutionMaximization(), value<Int>()->default_value("0"))
+    (CLUSTERING_HEURISTIC_FLAG, "in-process planner " + helpClusteringHeuristic() + " [or \"\" to read join tree from stdin]", value<string>()->default_value(""))
+    (CLUSTER_VAR_FLAG, helpClusterVarOrderHeuristic() + requireOption(CLUSTERING_HEURISTIC_FLAG, "\"\"", "!="), value<Int>()->default_value(to_string(LEX_P_HEURISTIC)))
     (PLANNER_WAIT_FLAG, "planner wait duration minimum (in seconds); float", value<Float>()->default_value("0.0"))
+    (PREPROCESS_FLAG, "preprocessing of CNF in process, keeping weighted (projected) count" + requireOption(CLUSTERING_HEURISTIC_FLAG, "\"\"", "!=") + ": 0, 1; int", value<Int>()->default_value("0"))
+    (JOIN_TREE_CACHE_FLAG, "join tree cache directory: cached join tree of same formula is used without planning, else planned join tree is cached [or \"\" for no cache]; string", value<string>()->default_value(""))
     (THREAD_COUNT_FLAG, "thread count [or 0 for hardware_concurrency value]; int", value<Int>()->default_value("1"))
     (RANDOM_SEED_FLAG, "random seed; int", value<Int>()->default_value("0"))
     (DYN_ORDER_FLAG, helpDynamicVarOrdering(), value<Int>()->default_value("0"))
+    (REORDER_BUDGET_FLAG, "reorder budget: max total reordering time as fraction of elapsed time, with reorders skipped while recent ones did not pay off" + requireOption(DYN_ORDER_FLAG, "0", ">") + " [or 0 for no cap]; float", value<Float>()->default_value("0.1"))
     (SAT_FILTER_FLAG, helpSatFilter(), value<Int>()->default_value("0"))
     (SCALING_FACTOR_FLAG, helpScalingFactor(), value<Float>()->default_value("0"))
     (ATOMIC_ABSTRACT_FLAG, helpAtomicAbstract(), value<Int>()->default_value("0"))
     (DD_VAR_FLAG, helpDiagramVarOrderHeuristic(), value<Int>()->default_value(to_string(MCS_HEURISTIC)))
+    (AUTOTUNE_FLAG, "autotuned diagram var order" + requireOption(DYN_ORDER_FLAG, "0") + ": candidate orders (dv_arg and all but RANDOM) are tried on this many sampled join subtrees, and the one with fewest diagram nodes is used [or 0 for dv_arg]; int", value<Int>()->default_value("0"))
+    (DIAGRAM_CACHE_FLAG, helpDiagramCache(), value<string>()->default_value(""))
+    (DIAGRAM_CACHE_SECONDS_FLAG, "min seconds to solve join subtree for its diagram to be cached" + requireOption(DIAGRAM_CACHE_FLAG, "\"\"", "!=") + "; float", value<Float>()->default_value("1.0"))
+    (CHECKPOINT_DIR_FLAG, helpCheckpointDir(), value<string>()->default_value(""))
+    (CHECKPOINT_INTERVAL_FLAG, "checkpoint interval (in seconds)" + requireOption(CHECKPOINT_DIR_FLAG, "\"\"", "!=") + "; float", value<Float>()->default_value("600.0"))
+    (RESUME_FLAG, "resume from latest checkpoint of same formula, with its join tree and diagram var order" + requireOption(CHECKPOINT_DIR_FLAG, "\"\"", "!=") + ": 0, 1; int", value<Int>()->default_value("0"))
     (MAX_MEM_FLAG, "maximum memory (in MB) for unique table and cache table combined [or 0 for unlimited memory with CUDD]; float", value<Float>()->default_value("4e3"))
     (TABLE_RATIO_FLAG, "table ratio" + requireDdPackage(SYLVAN_PACKAGE) + ": log2(unique_size/cache_size); int", value<Int>()->default_value("1"))
     (INIT_RATIO_FLAG, "init ratio for tables" + requireDdPackage(SYLVAN_PACKAGE) + ": log2(max_size/init_size); int", value<Int>()->default_value("10"))
     (MULTIPLE_PRECISION_FLAG, "multiple precision" + requireDdPackage(SYLVAN_PACKAGE) + ": 0, 1; int", value<Int>()->default_value("0"))
     (JOIN_PRIORITY_FLAG, helpJoinPriority(), value<string>()->default_value(SMALLEST_PAIR))
+    (REPORT_FILE_FLAG, "report file of timings, diagram stats and solution in JSON [or \"\" for no report]; string", value<string>()->default_value(""))
+    (STATUS_INTERVAL_FLAG, "status interval (in seconds) of executor sampler for RSS, unique table, cache and progress [or 0 for no sampler]; float", value<Float>()->default_value("0.0"))
+    (STATUS_FILE_FLAG, "status file, appended" + requireOption(STATUS_INTERVAL_FLAG, "0", ">") + " [or \"\" for status rows on stdout]; string", value<string>()->default_value(""))
+    (MEM_LIMIT_FLAG, "RSS limit (in MB) of memory governor" + requireOption(STATUS_INTERVAL_FLAG, "0", ">") + ": garbage collection at 80%, reordering at 90%, exit with partial results at 100% [or 0 for no governor]; float", value<Float>()->default_value("0.0"))
+    (HARDWARE_COUNTERS_FLAG, "hardware counters (cycles, instructions, LLC and dTLB misses) of main thread per phase and diagram operation, with Linux perf_event_open: 0, 1; int", value<Int>()->default_value("0"))
+    (TRACE_FILE_FLAG, "trace file of join nodes, GC and reordering in Chrome trace-event format, for Perfetto [or \"\" for no trace]; string", value<string>()->default_value(""))
     (VERBOSE_CNF_FLAG, helpVerboseCnfProcessing(), value<Int>()->default_value("0"))
     (VERBOSE_JOIN_TREE_FLAG, "verbose join-tree processing: 0, 1, 2", value<Int>()->default_value("0"))
     (VERBOSE_PROFILING_FLAG, "verbose profiling: 0, 1, 2; int", value<Int>()->default_value("0"))
@@ -472,21 +635,41 @@ const InputParams dpve::io::parseOptions(int argc, char** argv) {
   auto maximizerFormat = result[MAXIMIZER_FORMAT_FLAG].as<Int>(); // global var
   auto maximizerVerification = result[MAXIMIZER_VERIFICATION_FLAG].as<Int>(); // global var
   auto substitutionMaximization = result[SUBSTITUTION_MAXIMIZATION_FLAG].as<Int>(); // global var
+  auto clusteringHeuristic = result[CLUSTERING_HEURISTIC_FLAG].as<string>();
+  auto clusterVarOrderHeuristic = result[CLUSTER_VAR_FLAG].as<Int>();
   auto plannerWaitDuration = result[PLANNER_WAIT_FLAG].as<Float>();
     plannerWaitDuration = max(plannerWaitDuration, 0.0l);
+  auto preprocessing = result[PREPROCESS_FLAG].as<Int>();
+  auto joinTreeCacheDir = result[JOIN_TREE_CACHE_FLAG].as<string>();
   auto threadCount = result[THREAD_COUNT_FLAG].as<Int>(); // global var
   if (threadCount <= 0) {
     threadCount = thread::hardware_concurrency();
   }
   auto randomSeed = result[RANDOM_SEED_FLAG].as<Int>(); // global var
   auto dynVarOrdering = result[DYN_ORDER_FLAG].as<Int>();
+  auto checkpointDir = result[CHECKPOINT_DIR_FLAG].as<string>();
+  auto checkpointSeconds = result[CHECKPOINT_INTERVAL_FLAG].as<Float>();
+  auto resume = result[RESUME_FLAG].as<Int>();
+  auto reorderBudget = result[REORDER_BUDGET_FLAG].as<Float>();
+  auto reportFile = result[REPORT_FILE_FLAG].as<string>();
+  if (!reportFile.empty()) { // before rows are printed while reading CNF file
+    Report::open(reportFile);
+  }
+  auto hardwareCounters = result[HARDWARE_COUNTERS_FLAG].as<Int>();
+  auto statusSeconds = result[STATUS_INTERVAL_FLAG].as<Float>();
+  auto statusFile = result[STATUS_FILE_FLAG].as<string>();
+  auto memLimit = result[MEM_LIMIT_FLAG].as<Float>();
   auto satFilter = result[SAT_FILTER_FLAG].as<Int>();
   auto scalingFactor = result[SCALING_FACTOR_FLAG].as<Float>();
   auto atomicAbstract = result[ATOMIC_ABSTRACT_FLAG].as<Int>();
+  auto autotuneSubtrees = result[AUTOTUNE_FLAG].as<Int>();
   auto ddVarOrderHeuristic = result[DD_VAR_FLAG].as<Int>();
+  auto diagramCacheDir = result[DIAGRAM_CACHE_FLAG].as<string>();
+  auto diagramCacheSeconds = result[DIAGRAM_CACHE_SECONDS_FLAG].as<Float>();
   auto maxMem = result[MAX_MEM_FLAG].as<Float>(); // global var
     maxMem = max(maxMem, 0.0l);
   auto tableRatio = result[TABLE_RATIO_FLAG].as<Int>();
+  auto traceFile = result[TRACE_FILE_FLAG].as<string>();
   auto initRatio = result[INIT_RATIO_FLAG].as<Int>();
   auto multiplePrecision = result[MULTIPLE_PRECISION_FLAG].as<Int>(); // global var
   assert(!result.count(TABLE_RATIO_FLAG) || ddPackage == SYLVAN_PACKAGE);
@@ -502,7 +685,10 @@ const InputParams dpve::io::parseOptions(int argc, char** argv) {
   Number::multiplePrecision = multiplePrecision;//IMPORTANT!!
   Cnf cnf(verboseCnf,randomSeed,weightedCounting,projectedCounting);
   cnf.readCnfFile(cnfFilePath);
-  return InputParams(atomicAbstract, cnf, ddPackage, ddVarOrderHeuristic, dynVarOrdering, existRandom, initRatio, joinPriority, logCounting, multiplePrecision, maxMem, plannerWaitDuration, projectedCounting, pmParams, randomSeed, satFilter, scalingFactor, tableRatio, threadCount, toolStartPoint, verboseCnf, verboseJoinTree, verboseProfiling, verboseSolving, weightedCounting);
+  if (preprocessing) {
+    Preprocessor(cnf).preprocess();
+  }
+  return InputParams(atomicAbstract, autotuneSubtrees, checkpointDir, checkpointSeconds, clusteringHeuristic, clusterVarOrderHeuristic, cnf, ddPackage, ddVarOrderHeuristic, diagramCacheDir, diagramCacheSeconds, dynVarOrdering, existRandom, hardwareCounters, initRatio, joinPriority, joinTreeCacheDir, logCounting, multiplePrecision, maxMem, memLimit, plannerWaitDuration, preprocessing, projectedCounting, pmParams, randomSeed, reorderBudget, reportFile, resume, satFilter, statusFile, statusSeconds, scalingFactor, tableRatio, threadCount, toolStartPoint, traceFile, verboseCnf, verboseJoinTree, verboseProfiling, verboseSolving, weightedCounting);
 }
 
 bool dpve::io::validateOptions(InputParams& p){
@@ -528,6 +714,9 @@ bool dpve::io::validateOptions(InputParams& p){
   assert(p.threadCount > 0);
   // assert(p.dynVarOrdering == 0 || p.ddPackage == CUDD_PACKAGE); //Sylvan now supports some types of dynordering
   assert(p.ddPackage == CUDD_PACKAGE || p.dynVarOrdering == 0 || p.dynVarOrdering == 2);
+  assert(p.reorderBudget >= 0 && p.reorderBudget <= 1);
+  assert(p.autotuneSubtrees >= 0);
+  assert(p.autotuneSubtrees == 0 || p.dynVarOrdering == 0); // reordering during trials would move the var order being tried
   assert(p.satFilter >= 0 && p.satFilter <=2);
   assert((p.atomicAbstract == false) || (p.projectedCounting == false && p.existRandom == false && p.ddPackage == CUDD_PACKAGE) || 
         (p.projectedCounting == false && p.existRandom == false && p.weightedCounting == false && p.ddPackage == SYLVAN_PACKAGE));
@@ -536,7 +725,15 @@ bool dpve::io::validateOptions(InputParams& p){
   // assert(util:SLICE_VAR:getVarOrderHeuristics().contains(abs(p.sliceVarOrderHeuristic)));
   assert(!p.multiplePrecision || p.ddPackage == SYLVAN_PACKAGE);
   assert(JOIN_PRIORITIES.contains(p.joinPriority));
+  assert(p.clusteringHeuristic.empty() || CLUSTERING_HEURISTICS.contains(p.clusteringHeuristic));
+  assert(CNF_VAR_ORDER_HEURISTICS.contains(abs(p.clusterVarOrderHeuristic)));
+  assert(!p.preprocessing || (!p.clusteringHeuristic.empty() && !p.existRandom)); // external planner would read original formula; maximized inner vars must not be substituted
   assert(p.verboseProfiling <= 0 || p.threadCount == 1);
+  assert(p.diagramCacheDir.empty() || (!p.existRandom && p.satFilter == 0));
+  assert(p.checkpointDir.empty() || (p.satFilter == 0 && !p.pmParams.maximizerFormat));
+  assert(!p.resume || !p.checkpointDir.empty());
+  assert(p.statusSeconds >= 0);
+  assert(p.statusSeconds > 0 || (p.statusFile.empty() && p.memLimit == 0));
   return true;
 }
 
@@ -573,10 +770,35 @@ void dpve::io::InputParams::printParsed(){
     if (!weightedCounting && pmParams.maximizerFormat) {
       printRow("substitutionMaximization", pmParams.substitutionMaximization);
     }
-    printRow("plannerWaitSeconds", plannerWaitDuration);
+    if (clusteringHeuristic.empty()) {
+      printRow("plannerWaitSeconds", plannerWaitDuration);
+    }
+    else {
+      printRow("clusteringHeuristic", CLUSTERING_HEURISTICS.at(clusteringHeuristic));
+      printRow("clusterVarOrderHeuristic", (clusterVarOrderHeuristic < 0 ? "INVERSE_" : "") + CNF_VAR_ORDER_HEURISTICS.at(abs(clusterVarOrderHeuristic)));
+      printRow("preprocessing", preprocessing);
+    }
+    if (!joinTreeCacheDir.empty()) {
+      printRow("joinTreeCacheDir", joinTreeCacheDir);
+    }
     printRow("threadCount", threadCount);
     printRow("randomSeed", randomSeed);
+    if (dynVarOrdering > 0) {
+      printRow("reorderBudget", reorderBudget);
+    }
+    if (autotuneSubtrees > 0) {
+      printRow("autotuneSubtrees", autotuneSubtrees);
+    }
     printRow("diagramVarOrderHeuristic", (ddVarOrderHeuristic < 0 ? "INVERSE_" : "TODO!!"));// + CNF_VAR_ORDER_HEURISTICS.at(abs(ddVarOrderHeuristic)));
+    if (!checkpointDir.empty()) {
+      printRow("checkpointDir", checkpointDir);
+      printRow("checkpointSeconds", checkpointSeconds);
+      printRow("resume", resume);
+    }
+    if (!diagramCacheDir.empty()) {
+      printRow("diagramCacheDir", diagramCacheDir);
+      printRow("diagramCacheSeconds", diagramCacheSeconds);
+    }
     printRow("maxMemMegabytes", maxMem);
     if (ddPackage == SYLVAN_PACKAGE) {
       printRow("tableRatio", tableRatio);
@@ -584,6 +806,24 @@ void dpve::io::InputParams::printParsed(){
       printRow("multiplePrecision", multiplePrecision);
     }
     printRow("joinPriority", JOIN_PRIORITIES.at(joinPriority));
+    if (statusSeconds > 0) {
+      printRow("statusSeconds", statusSeconds);
+      if (!statusFile.empty()) {
+        printRow("statusFile", statusFile);
+      }
+      if (memLimit > 0) {
+        printRow("memLimitMegabytes", memLimit);
+      }
+    }
+    if (hardwareCounters) {
+      printRow("hardwareCounters", hardwareCounters);
+    }
+    if (!reportFile.empty()) {
+      printRow("reportFile", reportFile);
+    }
+    if (!traceFile.empty()) {
+      printRow("traceFile", traceFile);
+    }
     cout << "\n";
   }
 }
\ No newline at end of file
@@ -3,6 +3,12 @@
 #include "common.hpp"
 #include "formula.hpp"
 #include <iostream>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
 /* consts =================================================================== */
 
 namespace dpve{
@@ -24,26 +30,43 @@ namespace io{
   class InputParams{
     public:
       const bool atomicAbstract;
+      const Int autotuneSubtrees; // sampled subtrees for trials of diagram var orders; 0 if ddVarOrderHeuristic is used
+      const string checkpointDir; // empty if executor progress is not saved
+      const Float checkpointSeconds; // between checkpoints
+      const string clusteringHeuristic; // empty if join tree is read from stdin
+      const Int clusterVarOrderHeuristic;
       // const string cnfFilePath;
       const Cnf cnf;
       const string ddPackage;
       const Int ddVarOrderHeuristic;
+      const string diagramCacheDir; // empty if subtree DDs are not cached
+      const Float diagramCacheSeconds; // min time to solve subtree for its DD to be cached
       const Int dynVarOrdering;
       const bool existRandom;
+      const bool hardwareCounters; // per phase and DD operation
       const Int initRatio; // log2(max_size / init_size)
       const string joinPriority;
+      const string joinTreeCacheDir; // empty if join trees are not cached
       const bool logCounting;
       const bool multiplePrecision;
       const Float maxMem;
+      const Float memLimit; // of RSS in MB, for memory governor; 0 if off
       const Float plannerWaitDuration;
+      const bool preprocessing; // of CNF in process, before planning
       const bool projectedCounting;
       const PruneMaxParams pmParams;
       const Int randomSeed;
+      const Float reorderBudget; // max fraction of elapsed time spent reordering; 0 if uncapped
+      const string reportFile; // empty if no JSON report is written
+      const bool resume; // from checkpoint in checkpointDir
       const Int satFilter;
+      const string statusFile; // empty for status rows on stdout
+      const Float statusSeconds; // between samples; 0 if no sampler
       const Float scalingFactor; //preprocessors eg Arjun return a scalingFactor f such that final count c must be multiplied by (2**f) i.e. c*(2**f)
       const Int tableRatio; // log2(unique_table / cache_table)
       const Int threadCount;
       const TimePoint toolStartPoint;
+      const string traceFile; // empty if executor is not traced
       const Int verboseCnf;
       const Int verboseJoinTree;
       const Int verboseProfiling;
@@ -51,11 +74,11 @@ namespace io{
       const bool weightedCounting;
    
       void printParsed();
-      InputParams(const bool atomicAbstract, const Cnf cnf, const string ddPackage, 
-        const Int ddVarOrderHeuristic, const Int dynVarOrdering, const bool existRandom, const Int initRatio, const string joinPriority, 
-        const bool logCounting, const bool multiplePrecision, const Float maxMem, const Float plannerWaitDuration, 
-        const bool projectedCounting, const PruneMaxParams pmParams, const Int randomSeed, const Int satFilter, const Float scalingFactor,
-        const Int tableRatio, const Int threadCount, const TimePoint toolStartPoint, 
+      InputParams(const bool atomicAbstract, const Int autotuneSubtrees, const string checkpointDir, const Float checkpointSeconds, const string clusteringHeuristic, const Int clusterVarOrderHeuristic, const Cnf cnf, const string ddPackage, 
+        const Int ddVarOrderHeuristic, const string diagramCacheDir, const Float diagramCacheSeconds, const Int dynVarOrdering, const bool existRandom, const bool hardwareCounters, const Int initRatio, const string joinPriority, 
+        const string joinTreeCacheDir, const bool logCounting, const bool multiplePrecision, const Float maxMem, const Float memLimit, const Float plannerWaitDuration, const bool preprocessing, 
+        const bool projectedCounting, const PruneMaxParams pmParams, const Int randomSeed, const Float reorderBudget, const string reportFile, const bool resume, const Int satFilter, const string statusFile, const Float statusSeconds, const Float scalingFactor,
+        const Int tableRatio, const Int threadCount, const TimePoint toolStartPoint, const string traceFile,
         const Int verboseCnf, const Int verboseJoinTree, const Int verboseProfiling, const Int verboseSolving, const bool weightedCounting);
     private:
       InputParams();
@@ -67,6 +90,43 @@ namespace io{
   const InputParams parseOptions(int argc, char** argv);
   bool validateOptions(InputParams&);
 
+  string helpVerboseCnfProcessing();
+  string helpVerboseSolving();
+  string helpClusterVarOrderHeuristic();
+  string helpClusteringHeuristic();
+
+  class Report { // JSON file for dashboards: every printed row, plus fixed fields by section
+  public:
+    static bool isOpen();
+    static void open(const string& filePath); // fields are dropped until then, so it is opened while parsing options
+    static void close(); // writes file if opened
+
+    static void add(const string& section, const string& key, const string& val); // JSON string
+    template<typename T> static void add(const string& section, const string& key, const T& val) { // JSON number if `T` is arithmetic and `val` finite, else string
+      if (!isOpen()) { // before formatting, as every printed row is added
+        return;
+      }
+      std::ostringstream stream;
+      stream.precision(std::numeric_limits<Float>::digits10);
+      stream << val;
+      if constexpr (std::is_arithmetic_v<T>) {
+        if (std::isfinite(static_cast<Float>(val))) {
+          addJson(section, key, stream.str());
+          return;
+        }
+      }
+      add(section, key, stream.str());
+    }
+
+  private:
+    static void addJson(const string& section, const string& key, const string& json);
+
+    static string filePath;
+    static std::map<string, std::map<string, string>> sections; // section |-> key |-> JSON value, sorted so that output is stable
+    static std::mutex mutex; // fields are also added by sampler thread of Monitor, which may close report
+    static std::atomic<bool> opened; // read without lock
+  };
+
   void printRowKey(const string& key, size_t keyWidth);
 
   template<typename T> void printRow(const string& key, const T& val, size_t keyWidth = 32){
@@ -76,6 +136,7 @@ namespace io{
     // cout.precision(std::numeric_limits<Float>::digits10); // default for Float: 6 digits
     std::cout << val << "\n";
     std::cout.precision(p);
+    Report::add("rows", key, val);
   }
 
   void printPreamble(int argc, char** argv);
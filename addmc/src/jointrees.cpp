@@ -3,15 +3,17 @@
 #include "formula.hpp"
 #include "io.hpp"
 #include "util.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <queue>
 #include <signal.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 /* class JoinTree =========================================================== */
 
-const string JOIN_TREE_WORD = "jt";
-const string ELIM_VARS_WORD = "e";
 
 using dpve::io::WARNING;
 using dpve::io::DASH_LINE;
@@ -21,9 +23,12 @@ using dpve::JoinNode;
 using dpve::JoinTree;
 using dpve::JoinNonterminal;
 using dpve::JoinTreeProcessor;
+using dpve::JoinTreeCache;
 using dpve::JoinTerminal;
 using dpve::Assignment;
-using dpve::Label;
+using dpve::Graph;
+using dpve::InducedSubgraph;
+using dpve::LabelRanks;
 using dpve::Cnf;
 using dpve::Int;
 using dpve::Set;
@@ -35,26 +40,364 @@ using std::min;
 using std::setw;
 using std::to_string;
 
-JoinNode* JoinTree::getJoinNode(Int nodeIndex) const {
-  if (joinTerminals.contains(nodeIndex)) {
-    return joinTerminals.at(nodeIndex);
+Int JoinTree::getRoot() const {
+  return declaredNodeCount - 1;
+}
+
+bool JoinTree::isTerminal(Int node) const {
+  return node < declaredClauseCount;
+}
+
+std::span<const Int> JoinTree::getChildren(Int node) const {
+  return std::span<const Int>(children.data() + childOffsets.at(node), children.data() + childOffsets.at(node + 1));
+}
+
+std::span<const Int> JoinTree::getProjectionVars(Int node) const {
+  return std::span<const Int>(projectionVars.data() + projectionVarOffsets.at(node), projectionVars.data() + projectionVarOffsets.at(node + 1));
+}
+
+std::span<const Int> JoinTree::getPreProjectionVars(Int node) const {
+  return std::span<const Int>(preProjectionVars.data() + preProjectionVarOffsets.at(node), preProjectionVars.data() + preProjectionVarOffsets.at(node + 1));
+}
+
+Int JoinTree::getWidth(const Assignment& assignment) const {
+  Int width = 0;
+  for (Int node : postOrder) {
+    Int nodeWidth = 0;
+    for (Int var : getPreProjectionVars(node)) {
+      if (!assignment.contains(var)) {
+        nodeWidth++;
+      }
+    }
+    width = max(width, nodeWidth);
+  }
+  return width;
+}
+
+void JoinTree::printTree(std::ostream& out, const string& startWord, const vector<Int>& clauseRanks) const {
+  out << startWord << "p " << JOIN_TREE_WORD << " " << declaredVarCount << " " << declaredClauseCount << " " << declaredNodeCount << "\n";
+  for (Int node : postOrder) {
+    if (isTerminal(node)) {
+      continue;
+    }
+    out << startWord << node + 1 << " ";
+    for (Int child : getChildren(node)) {
+      out << (isTerminal(child) && !clauseRanks.empty() ? clauseRanks.at(child) : child) + 1 << " ";
+    }
+    out << ELIM_VARS_WORD;
+    for (Int var : getProjectionVars(node)) {
+      out << " " << var;
+    }
+    out << "\n";
+  }
+}
+
+Int JoinTree::getNonterminalCount() const {
+  return rowChildOffsets.size() - 1;
+}
+
+bool JoinTree::hasNonterminal(Int node) const {
+  return node >= 0 && node < nodeRows.size() && nodeRows.at(node) >= 0;
+}
+
+void JoinTree::addNonterminal(Int node, const vector<Int>& nodeChildren, vector<Int> nodeProjectionVars) {
+  nodeRows.at(node) = getNonterminalCount();
+  rowChildren.insert(rowChildren.end(), nodeChildren.begin(), nodeChildren.end());
+  rowChildOffsets.push_back(rowChildren.size());
+
+  sort(nodeProjectionVars.begin(), nodeProjectionVars.end());
+  nodeProjectionVars.erase(unique(nodeProjectionVars.begin(), nodeProjectionVars.end()), nodeProjectionVars.end());
+  rowVars.insert(rowVars.end(), nodeProjectionVars.begin(), nodeProjectionVars.end());
+  rowVarOffsets.push_back(rowVars.size());
+}
+
+void JoinTree::finish(const Cnf& cnf) {
+  childOffsets.assign(1, 0);
+  projectionVarOffsets.assign(1, 0);
+  children.reserve(rowChildren.size());
+  projectionVars.reserve(rowVars.size());
+  for (Int node = 0; node < declaredNodeCount; node++) {
+    Int row = nodeRows.at(node);
+    if (row >= 0) {
+      children.insert(children.end(), rowChildren.begin() + rowChildOffsets.at(row), rowChildren.begin() + rowChildOffsets.at(row + 1));
+      projectionVars.insert(projectionVars.end(), rowVars.begin() + rowVarOffsets.at(row), rowVars.begin() + rowVarOffsets.at(row + 1));
+    }
+    childOffsets.push_back(children.size());
+    projectionVarOffsets.push_back(projectionVars.size());
+  }
+  vector<Int>().swap(nodeRows);
+  vector<Int>().swap(rowChildOffsets);
+  vector<Int>().swap(rowChildren);
+  vector<Int>().swap(rowVarOffsets);
+  vector<Int>().swap(rowVars);
+
+  preProjectionVarOffsets.assign(1, 0);
+  vector<Int> varMarks(declaredVarCount + 1, -1); // var |-> latest node containing var
+  vector<Int> nodeVars;
+  for (Int node = 0; node < declaredNodeCount; node++) { // children before parents
+    nodeVars.clear();
+    if (isTerminal(node)) {
+      for (Int literal : cnf.clauses.at(node)) {
+        Int var = abs(literal);
+        if (varMarks.at(var) != node) {
+          varMarks.at(var) = node;
+          nodeVars.push_back(var);
+        }
+      }
+    }
+    else {
+      for (Int child : getChildren(node)) {
+        std::span<const Int> childProjectionVars = getProjectionVars(child);
+        auto projectionVar = childProjectionVars.begin();
+        for (Int var : getPreProjectionVars(child)) { // both ascending
+          while (projectionVar != childProjectionVars.end() && *projectionVar < var) {
+            projectionVar++;
+          }
+          if ((projectionVar == childProjectionVars.end() || *projectionVar != var) && varMarks.at(var) != node) {
+            varMarks.at(var) = node;
+            nodeVars.push_back(var);
+          }
+        }
+      }
+    }
+    sort(nodeVars.begin(), nodeVars.end());
+    preProjectionVars.insert(preProjectionVars.end(), nodeVars.begin(), nodeVars.end());
+    preProjectionVarOffsets.push_back(preProjectionVars.size());
+  }
+
+  postOrder.clear();
+  vector<pair<Int, Int>> stack{{getRoot(), 0}}; // node, index of next child
+  while (!stack.empty()) {
+    auto [node, childIndex] = stack.back();
+    std::span<const Int> nodeChildren = getChildren(node);
+    if (childIndex < nodeChildren.size()) {
+      stack.back().second++;
+      Int child = nodeChildren[childIndex];
+      if (isTerminal(child)) {
+        postOrder.push_back(child);
+      }
+      else {
+        stack.push_back({child, 0});
+      }
+    }
+    else {
+      postOrder.push_back(node);
+      stack.pop_back();
+    }
+  }
+}
+
+vector<Int> JoinTree::getBiggestNodeVarOrder(const Cnf& cnf) const {
+  Map<Int, size_t> varSizes; // var x |-> size of biggest node containing x
+  for (Int var : cnf.apparentVars) {
+    varSizes[var] = 0;
+  }
+
+  for (Int node : postOrder) {
+    std::span<const Int> vars = getPreProjectionVars(node);
+    for (Int var : vars) {
+      varSizes[var] = max(varSizes[var], vars.size());
+    }
+  }
+
+  multimap<size_t, Int, greater<size_t>> sizedVars = dpve::util::flipMap(varSizes); // size |-> var
+
+  size_t prevSize = 0;
+
+  if (verboseSolving >= 2) {
+    cout << DASH_LINE;
+  }
+
+  vector<Int> varOrder;
+  for (const auto& [varSize, var] : sizedVars) {
+    varOrder.push_back(var);
+
+    if (verboseSolving >= 2) {
+      if (prevSize == varSize) {
+        cout << " " << var;
+      }
+      else {
+        if (prevSize > 0) {
+          cout << "\n";
+        }
+        prevSize = varSize;
+        cout << "c vars in nodes of size " << std::right << std::setw(5) << varSize << ": " << var;
+      }
+    }
+  }
+
+  if (verboseSolving >= 2) {
+    cout << "\n" << DASH_LINE;
+  }
+
+  return varOrder;
+}
+
+vector<Int> JoinTree::getHighestNodeVarOrder() const {
+  vector<Int> varOrder;
+  std::queue<Int> q;
+  q.push(getRoot());
+  while (!q.empty()) {
+    Int node = q.front();
+    q.pop();
+    for (Int var : getProjectionVars(node)) {
+      varOrder.push_back(var);
+    }
+    for (Int child : getChildren(node)) {
+      if (!isTerminal(child)) {
+        q.push(child);
+      }
+    }
+  }
+  return varOrder;
+}
+
+vector<Int> JoinTree::getLexPVarOrder(const Cnf& cnf) const {
+  vector<bool> processedVars(declaredVarCount + 1);
+  vector<Int> varOrder;
+  const Graph& primalGraph = cnf.getPrimalGraph();
+  vector<Int> localIds(primalGraph.getVertexCount(), -1); // shared by induced subgraphs of join nodes
+  vector<Int> tiebreakerinv = cnf.getMostClausesVarOrder();
+  Map<Int, Int> tiebreaker;
+  for (Int i = 0; i<tiebreakerinv.size(); i++){
+    tiebreaker[tiebreakerinv[i]] = i; 
   }
-  return joinNonterminals.at(nodeIndex);
+  std::queue<Int> q;
+  q.push(getRoot());
+  while (!q.empty()) {
+    Int node = q.front();
+    q.pop();
+    auto vo = getLexPVarRanking(node, primalGraph, localIds, processedVars, tiebreaker);
+    varOrder.insert(varOrder.end(),vo.begin(),vo.end());
+    for (Int child : getChildren(node)) {
+      if (!isTerminal(child)) {
+        q.push(child);
+      }
+    }
+  }
+  return varOrder;
 }
 
-JoinNonterminal* JoinTree::getJoinRoot() const {
-  return joinNonterminals.at(declaredNodeCount - 1);
+vector<Int> JoinTree::getLexPVarRanking(Int node, const Graph& primalGraph, vector<Int>& localIds, vector<bool>& processedVars, const Map<Int, Int>& tiebreaker) const {
+  vector<Int> vars;
+  for (Int var : getPreProjectionVars(node)) {
+    if (!processedVars.at(var)) {
+      vars.push_back(var);
+    }
+  }
+  InducedSubgraph subgraph(primalGraph, vars, localIds);
+  Int vertexCount = subgraph.denseIds.size();
+  vector<Int> tiebreaks(vertexCount); // local id |-> tiebreaker for equal labels
+  for (Int u = 0; u < vertexCount; u++) {
+    tiebreaks.at(u) = tiebreaker.at(primalGraph.vertices.at(subgraph.denseIds.at(u)));
+  }
+
+  LabelRanks labels(vertexCount);
+  vector<bool> numbered(vertexCount);
+  vector<Int> numberedVertices; // whose alpha numbers are decreasing
+  for (Int step = 0; step < vertexCount; step++) {
+    Int vertex = -1;
+    for (Int u = 0; u < vertexCount; u++) {
+      if (!numbered.at(u) && (vertex < 0 || pair(labels.at(u), tiebreaks.at(u)) > pair(labels.at(vertex), tiebreaks.at(vertex)))) {
+        vertex = u;
+      }
+    }
+    numbered.at(vertex) = true;
+    numberedVertices.push_back(primalGraph.vertices.at(subgraph.denseIds.at(vertex)));
+    for (Int neighbor : subgraph.getNeighbors(vertex)) {
+      if (!numbered.at(neighbor)) {
+        labels.addNumber(neighbor);
+      }
+    }
+    labels.renumber(numbered);
+  }
+  for (Int var : vars) {
+    processedVars.at(var) = true;
+  }
+  return numberedVertices;
 }
 
-void JoinTree::printTree() const {
-  cout << "c p " << JOIN_TREE_WORD << " " << declaredVarCount << " " << declaredClauseCount << " " << declaredNodeCount << "\n";
-  getJoinRoot()->printSubtree("c ");
+vector<Int> JoinTree::getVarOrder(Int varOrderHeuristic, const Cnf& cnf) const {
+  if (CNF_VAR_ORDER_HEURISTICS.contains(abs(varOrderHeuristic))) {
+    return cnf.getCnfVarOrder(varOrderHeuristic);
+  }
+
+  vector<Int> varOrder;
+  if (abs(varOrderHeuristic) == dpve::BIGGEST_NODE_HEURISTIC) { // 8
+    varOrder = getBiggestNodeVarOrder(cnf);
+  } else if (abs(varOrderHeuristic)== 10){
+    varOrder = getLexPVarOrder(cnf);
+  } else {
+    assert(abs(varOrderHeuristic) == HIGHEST_NODE_HEURISTIC); //9
+    varOrder = getHighestNodeVarOrder();
+  }
+
+  if (varOrderHeuristic < 0) {
+    reverse(varOrder.begin(), varOrder.end());
+  }
+
+  return varOrder;
+}
+
+vector<Assignment> JoinTree::getOuterAssignments(Int varOrderHeuristic, Int sliceVarCount, const Cnf& cnf) const {
+  if (sliceVarCount <= 0) {
+    return {Assignment()};
+  }
+
+  TimePoint sliceVarOrderStartPoint = util::getTimePoint();
+  vector<Int> varOrder = getVarOrder(varOrderHeuristic, cnf);
+  if (verboseSolving >= 1) {
+    io::printRow("sliceVarSeconds", util::getDuration(sliceVarOrderStartPoint));
+  }
+
+  TimePoint assignmentsStartPoint = util::getTimePoint();
+  vector<Assignment> assignments;
+
+  if (verboseSolving >= 2) {
+    cout << "c slice var order heuristic: {";
+  }
+
+  for (Int i = 0, assignedVars = 0; i < varOrder.size() && assignedVars < sliceVarCount; i++) {
+    Int var = varOrder.at(i);
+    if (cnf.outerVars.contains(var)) {
+      assignments = Assignment::getExtendedAssignments(assignments, var);
+      assignedVars++;
+      if (verboseSolving >= 2) {
+        cout << " " << var;
+      }
+    }
+  }
+
+  if (verboseSolving >= 2) {
+    cout << " }\n";
+  }
+
+  if (verboseSolving >= 1) {
+    dpve::io::printRow("sliceAssignmentsSeconds", dpve::util::getDuration(assignmentsStartPoint));
+  }
+
+  return assignments;
 }
 
 JoinTree::JoinTree(Int declaredVarCount, Int declaredClauseCount, Int declaredNodeCount) {
   this->declaredVarCount = declaredVarCount;
   this->declaredClauseCount = declaredClauseCount;
   this->declaredNodeCount = declaredNodeCount;
+
+  nodeRows.assign(max(declaredNodeCount, 0LL), -1);
+}
+
+JoinTree::JoinTree(const JoinNonterminal* root, Int declaredVarCount, Int declaredClauseCount, Int declaredNodeCount, const Cnf& cnf):
+  JoinTree(declaredVarCount, declaredClauseCount, declaredNodeCount) {
+  vector<Int> nodeChildren;
+  for (const JoinNonterminal* node : root->getNonterminalPostOrder()) {
+    nodeChildren.clear();
+    for (const JoinNode* child : node->children) {
+      nodeChildren.push_back(child->nodeIndex);
+    }
+    addNonterminal(node->nodeIndex, nodeChildren, vector<Int>(node->projectionVars.begin(), node->projectionVars.end()));
+  }
+  finish(cnf);
 }
 
 /* class JoinTreeProcessor ================================================== */
@@ -77,6 +420,17 @@ void JoinTreeProcessor::killPlanner() {
   }
 }
 
+void JoinTreeProcessor::killPlannerOnStdin() {
+  string line;
+  while (plannerPid == MIN_INT && getline(std::cin, line)) { // planner prints pid before join trees
+    vector<string> words = dpve::util::splitInputLine(line);
+    if (words.size() == 3 && words.at(0) == "c" && words.at(1) == "pid") {
+      plannerPid = stoll(words.at(2));
+    }
+  }
+  killPlanner();
+}
+
 void JoinTreeProcessor::handleSigAlrm(int signal) {
   assert(signal == SIGALRM);
   cout << "c received SIGALRM after " << dpve::util::getDuration(toolStartPoint) << "s\n";
@@ -123,8 +477,8 @@ void JoinTreeProcessor::disarmTimer() {
   cout << "c disarmed timer\n";
 }
 
-const JoinNonterminal* JoinTreeProcessor::getJoinTreeRoot() const {
-  return joinTree->getJoinRoot();
+const JoinTree* JoinTreeProcessor::getJoinTree() const {
+  return joinTree;
 }
 
 void JoinTreeProcessor::processCommentLine(const vector<string>& words) {
@@ -153,27 +507,44 @@ void JoinTreeProcessor::processProblemLine(const vector<string>& words) {
   }
   problemLineIndex = lineIndex;
 
-  if (words.size() != 5) {
-    throw MyError("problem line ", lineIndex, " has ", words.size(), " words (should be 5)");
+  string jtWord = words.size() > 1 ? words.at(1) : "";
+  if (jtWord != JOIN_TREE_WORD && jtWord != BINARY_JOIN_TREE_WORD) {
+    throw MyError("expected '", JOIN_TREE_WORD, "' or '", BINARY_JOIN_TREE_WORD, "'; found '", jtWord, "' | line ", lineIndex);
   }
 
-  string jtWord = words.at(1);
-  if (jtWord != JOIN_TREE_WORD) {
-    throw MyError("expected '", JOIN_TREE_WORD, "'; found '", jtWord, "' | line ", lineIndex);
+  bool binary = jtWord == BINARY_JOIN_TREE_WORD;
+  Int expectedWordCount = binary ? 6 : 5;
+  if (words.size() != expectedWordCount) {
+    throw MyError("problem line ", lineIndex, " has ", words.size(), " words (should be ", expectedWordCount, ")");
   }
 
   Int declaredVarCount = stoll(words.at(2));
   Int declaredClauseCount = stoll(words.at(3));
   Int declaredNodeCount = stoll(words.at(4));
 
+  if (declaredClauseCount > cnf.clauses.size()) {
+    throw MyError("join tree declares ", declaredClauseCount, " clauses (CNF has ", cnf.clauses.size(), ") | line ", lineIndex);
+  }
   joinTree = new JoinTree(declaredVarCount, declaredClauseCount, declaredNodeCount);
 
-  for (Int terminalIndex = 0; terminalIndex < declaredClauseCount; terminalIndex++) {
-    joinTree->joinTerminals[terminalIndex] = new JoinTerminal(cnf);
+  if (binary) {
+    Int byteCount = stoll(words.at(5));
+    string bytes(byteCount, '\0');
+    if (!input.read(bytes.data(), byteCount)) { // e.g. planner killed at timeout while writing: like a truncated text join tree
+      cout << WARNING << "binary join tree after line " << lineIndex << " has " << input.gcount() << " bytes (" << byteCount << " expected); dropping it\n";
+      delete joinTree;
+      joinTree = nullptr;
+      problemLineIndex = MIN_INT;
+      return;
+    }
+    if (verboseJoinTree >= 2) {
+      cout << "c binary join tree: " << byteCount << " bytes\n";
+    }
+    processBinaryNonterminals(bytes);
   }
 }
 
-void JoinTreeProcessor::processNonterminalLine(const vector<string>& words) {
+void JoinTreeProcessor::processNonterminalLine(std::string_view line) {
   if (problemLineIndex == MIN_INT) {
     string message = "no problem line before internal node | line " + to_string(lineIndex);
     if (joinTreeEndLineIndex != MIN_INT) {
@@ -182,50 +553,84 @@ void JoinTreeProcessor::processNonterminalLine(const vector<string>& words) {
     throw MyError(message);
   }
 
-  Int parentIndex = stoll(words.front()) - 1; // 0-indexing
-  if (parentIndex < joinTree->declaredClauseCount || parentIndex >= joinTree->declaredNodeCount) {
-    throw MyError("wrong internal-node index | line ", lineIndex);
-  }
+  Int parentIndex = dpve::util::parseInt(dpve::util::getNextWord(line)) - 1; // 0-indexing
 
-  vector<JoinNode*> children;
-  Set<Int> projectionVars;
+  vector<Int> childIndices;
+  vector<Int> projectionVars;
   bool parsingElimVars = false;
-  for (Int i = 1; i < words.size(); i++) {
-    string word = words.at(i);
+  for (std::string_view word = dpve::util::getNextWord(line); !word.empty(); word = dpve::util::getNextWord(line)) {
     if (word == ELIM_VARS_WORD) {
       parsingElimVars = true;
     }
+    else if (parsingElimVars) {
+      projectionVars.push_back(dpve::util::parseInt(word));
+    }
     else {
-      Int num = stoll(word);
-      if (parsingElimVars) {
-        Int declaredVarCount = joinTree->declaredVarCount;
-        if (num <= 0 || num > declaredVarCount) {
-          throw MyError("var '", num, "' inconsistent with declared var count '", declaredVarCount, "' | line ", lineIndex);
-        }
-        projectionVars.insert(num);
-      }
-      else {
-        Int childIndex = num - 1; // 0-indexing
-        if (childIndex < 0 || childIndex >= parentIndex) {
-          throw MyError("child '", word, "' wrong | line ", lineIndex);
-        }
-        children.push_back(joinTree->getJoinNode(childIndex));
-      }
+      childIndices.push_back(dpve::util::parseInt(word) - 1); // 0-indexing
+    }
+  }
+  addNonterminal(parentIndex, childIndices, projectionVars);
+}
+
+void JoinTreeProcessor::processBinaryNonterminals(std::string_view bytes) {
+  vector<Int> childIndices;
+  vector<Int> projectionVars;
+  while (!bytes.empty()) {
+    Int parentIndex = dpve::util::readVarint(bytes) - 1; // 0-indexing
+
+    childIndices.clear();
+    for (Int childCount = dpve::util::readVarint(bytes); childCount > 0; childCount--) {
+      childIndices.push_back(dpve::util::readVarint(bytes) - 1);
+    }
+
+    projectionVars.clear();
+    for (Int varCount = dpve::util::readVarint(bytes); varCount > 0; varCount--) {
+      projectionVars.push_back(dpve::util::readVarint(bytes));
+    }
+
+    addNonterminal(parentIndex, childIndices, projectionVars);
+  }
+}
+
+void JoinTreeProcessor::addNonterminal(Int parentIndex, vector<Int> childIndices, const vector<Int>& projectionVars) {
+  if (parentIndex < joinTree->declaredClauseCount || parentIndex >= joinTree->declaredNodeCount) {
+    throw MyError("wrong internal-node index | line ", lineIndex);
+  }
+  if (joinTree->hasNonterminal(parentIndex)) {
+    throw MyError("internal node '", parentIndex + 1, "' already taken | line ", lineIndex);
+  }
+
+  for (Int& childIndex : childIndices) {
+    if (childIndex >= 0 && childIndex < clauseIndices.size()) { // canonical clause rank in cache file
+      childIndex = clauseIndices.at(childIndex);
+    }
+    if (childIndex < 0 || childIndex >= parentIndex || (!joinTree->isTerminal(childIndex) && !joinTree->hasNonterminal(childIndex))) {
+      throw MyError("child '", childIndex + 1, "' wrong | line ", lineIndex);
     }
   }
-  joinTree->joinNonterminals[parentIndex] = new JoinNonterminal(children, projectionVars, parentIndex);
+
+  Int declaredVarCount = joinTree->declaredVarCount;
+  for (Int var : projectionVars) {
+    if (var <= 0 || var > declaredVarCount) {
+      throw MyError("var '", var, "' inconsistent with declared var count '", declaredVarCount, "' | line ", lineIndex);
+    }
+  }
+
+  joinTree->addNonterminal(parentIndex, childIndices, projectionVars);
 }
 
 void JoinTreeProcessor::finishReadingJoinTree() {
-  Int nonterminalCount = joinTree->joinNonterminals.size();
+  Int nonterminalCount = joinTree->getNonterminalCount();
   Int expectedNonterminalCount = joinTree->declaredNodeCount - joinTree->declaredClauseCount;
 
   if (nonterminalCount < expectedNonterminalCount) {
     cout << WARNING << "missing internal nodes (" << expectedNonterminalCount << " expected, " << nonterminalCount << " found) before current join tree ends on line " << lineIndex << "\n";
+    delete joinTree;
   }
   else {
+    joinTree->finish(cnf);
     if (joinTree->width == MIN_INT) {
-      joinTree->width = joinTree->getJoinRoot()->getWidth();
+      joinTree->width = joinTree->getWidth();
     }
 
     cout << "c processed join tree ending on line " << lineIndex << "\n";
@@ -240,8 +645,11 @@ void JoinTreeProcessor::finishReadingJoinTree() {
 
     joinTreeEndLineIndex = lineIndex;
     if (backupJoinTree==nullptr || joinTree->width < backupJoinTree->width){
+      delete backupJoinTree;
       backupJoinTree = joinTree;
-      JoinNode::resetStaticFields(); 
+    }
+    else {
+      delete joinTree;
     }
   }
 
@@ -251,16 +659,17 @@ void JoinTreeProcessor::finishReadingJoinTree() {
 
 void JoinTreeProcessor::readInputStream() {
   string line;
-  while (getline(std::cin, line)) {
+  while (getline(input, line)) {
     lineIndex++;
 
     if (verboseJoinTree >= 2) {
       dpve::io::printInputLine(line, lineIndex);
     }
 
-    vector<string> words = dpve::util::splitInputLine(line);
-    if (words.empty()) {}
-    else if (words.front() == "=") { // LG's tree separator "="
+    std::string_view lineRest = line;
+    std::string_view frontWord = dpve::util::getNextWord(lineRest);
+    if (frontWord.empty()) {}
+    else if (frontWord == "=") { // LG's tree separator "="
       if (joinTree != nullptr) {
         finishReadingJoinTree();
       }
@@ -268,14 +677,14 @@ void JoinTreeProcessor::readInputStream() {
         break;
       }
     }
-    else if (words.front() == "c") { // possibly special comment line
-      processCommentLine(words);
+    else if (frontWord == "c") { // possibly special comment line
+      processCommentLine(dpve::util::splitInputLine(line));
     }
-    else if (words.front() == "p") { // problem line
-      processProblemLine(words);
+    else if (frontWord == "p") { // problem line
+      processProblemLine(dpve::util::splitInputLine(line));
     }
     else { // nonterminal-node line
-      processNonterminalLine(words);
+      processNonterminalLine(line);
     }
   }
 
@@ -289,27 +698,28 @@ void JoinTreeProcessor::readInputStream() {
   }
 }
 
-JoinTreeProcessor::JoinTreeProcessor(Float plannerWaitDuration, const Cnf& cnf): cnf(cnf) {
-  cout << "c processing join tree...\n";
-
-  armTimer(plannerWaitDuration);
-  cout << "c getting join tree from stdin with " << plannerWaitDuration << "s timer (end input with 'enter' then 'ctrl d')\n";
-
-  readInputStream();
-
+void JoinTreeProcessor::chooseJoinTree() {
   if (joinTree == nullptr) {
     if (backupJoinTree == nullptr) {
       throw MyError("no join tree before line ", lineIndex);
     }
     joinTree = backupJoinTree;
-    JoinNode::restoreStaticFields();
     // joinTree->printTree();
   } else{
     if (backupJoinTree != nullptr && backupJoinTree->width < joinTree->width){
       joinTree = backupJoinTree;
-      JoinNode::restoreStaticFields();
     }
   }
+}
+
+JoinTreeProcessor::JoinTreeProcessor(Float plannerWaitDuration, const Cnf& cnf): cnf(cnf), input(std::cin) {
+  cout << "c processing join tree...\n";
+
+  armTimer(plannerWaitDuration);
+  cout << "c getting join tree from stdin with " << plannerWaitDuration << "s timer (end input with 'enter' then 'ctrl d')\n";
+
+  readInputStream();
+  chooseJoinTree();
 
   cout << "c getting join tree from stdin: done\n";
 
@@ -318,33 +728,89 @@ JoinTreeProcessor::JoinTreeProcessor(Float plannerWaitDuration, const Cnf& cnf):
   }
 }
 
+JoinTreeProcessor::JoinTreeProcessor(std::istream& input, const Cnf& cnf, const vector<Int>& clauseIndices): cnf(cnf), input(input), clauseIndices(clauseIndices) {
+  cout << "c processing cached join tree...\n";
+  readInputStream();
+  chooseJoinTree();
+}
 
-/* class JoinNode =========================================================== */
+/* class JoinTreeCache ====================================================== */
 
-Int JoinNode::nodeCount;
-Int JoinNode::terminalCount;
-Set<Int> JoinNode::nonterminalIndices;
+bool JoinTreeCache::hasJoinTree() const {
+  return !filePath.empty() && std::filesystem::exists(filePath);
+}
 
-Int JoinNode::backupNodeCount;
-Int JoinNode::backupTerminalCount;
-Set<Int> JoinNode::backupNonterminalIndices;
+Int JoinTreeCache::getCachedWidth() const {
+  if (!hasJoinTree()) {
+    return MAX_INT;
+  }
+  std::ifstream file(filePath);
+  string line;
+  getline(file, line); // c joinTreeWidth <width>
+  vector<string> words = dpve::util::splitInputLine(line);
+  if (words.size() != 3 || words.at(1) != "joinTreeWidth") {
+    cout << WARNING << "ignoring malformed join tree cache file " << filePath << "\n";
+    return MAX_INT;
+  }
+  return stoll(words.at(2));
+}
+
+const JoinTree* JoinTreeCache::loadJoinTree(const Cnf& cnf) const {
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file) {
+    throw MyError("unable to open join tree cache file ", filePath);
+  }
+  cout << "c reading join tree from cache file " << filePath << "\n";
+  JoinTreeProcessor joinTreeProcessor(file, cnf, clauseIndices);
+  return joinTreeProcessor.getJoinTree();
+}
+
+bool JoinTreeCache::storeJoinTree(const JoinTree& joinTree) const {
+  if (filePath.empty() || getCachedWidth() <= joinTree.width) {
+    return false;
+  }
+
+  std::filesystem::path path(filePath);
+  std::filesystem::create_directories(path.parent_path());
+  string tempFilePath = filePath + "." + to_string(getpid()); // then renamed, so that concurrent runs never read a partial file
+  {
+    std::ofstream file(tempFilePath);
+    file << "c joinTreeWidth " << joinTree.width << "\n"; // read by getCachedWidth; ignored by JoinTreeProcessor before problem line
+    joinTree.printTree(file, "", clauseRanks);
+    file << "c joinTreeWidth " << joinTree.width << "\n"; // read by JoinTreeProcessor
+    file << "c seconds " << joinTree.plannerDuration << "\n";
+    if (!file) {
+      cout << WARNING << "unable to write join tree cache file " << tempFilePath << "\n";
+      return false;
+    }
+  }
+  std::filesystem::rename(tempFilePath, path);
+  cout << "c stored join tree of width " << joinTree.width << " in cache file " << filePath << "\n";
+  return true;
+}
+
+JoinTreeCache::JoinTreeCache(const string& cacheDir, const Cnf& cnf):
+  filePath(cacheDir.empty() ? "" : (std::filesystem::path(cacheDir) / (cnf.getHash() + ".jt")).string()) {
+  if (!cacheDir.empty()) {
+    clauseIndices = cnf.getCanonicalClauseOrder();
+    clauseRanks.resize(clauseIndices.size());
+    for (Int rank = 0; rank < clauseIndices.size(); rank++) {
+      clauseRanks.at(clauseIndices.at(rank)) = rank;
+    }
+  }
+}
+
+
+/* class JoinNode =========================================================== */
+
+thread_local Int JoinNode::nodeCount;
+thread_local Int JoinNode::terminalCount;
 
 // Cnf JoinNode::cnf;
 
 void JoinNode::resetStaticFields() {
-  backupNodeCount = nodeCount;
-  backupTerminalCount = terminalCount;
-  backupNonterminalIndices = nonterminalIndices;
-
   nodeCount = 0;
   terminalCount = 0;
-  nonterminalIndices.clear();
-}
-
-void JoinNode::restoreStaticFields() {
-  nodeCount = backupNodeCount;
-  terminalCount = backupTerminalCount;
-  nonterminalIndices = backupNonterminalIndices;
 }
 
 Set<Int> JoinNode::getPostProjectionVars() const {
@@ -405,13 +871,6 @@ Int JoinTerminal::getWidth(const Assignment& assignment) const {
   return util::getDiff(preProjectionVars, assignment).size();
 }
 
-void JoinTerminal::updateVarSizes(Map<Int, size_t>& varSizes, const Cnf& cnf) const {
-  Set<Int> vars = cnf.clauses.at(nodeIndex).getClauseVars();
-  for (Int var : vars) {
-    varSizes[var] = max(varSizes[var], vars.size());
-  }
-}
-
 JoinTerminal::JoinTerminal(const Cnf& cnf) {
   nodeIndex = terminalCount;
   terminalCount++;
@@ -438,227 +897,70 @@ void JoinNonterminal::printNode(const string& startWord) const {
 }
 
 void JoinNonterminal::printSubtree(const string& startWord) const {
-  for (const JoinNode* child : children) {
-    if (!child->isTerminal()) {
-      static_cast<const JoinNonterminal*>(child)->printSubtree(startWord);
-    }
-  }
-  printNode(startWord);
-}
-
-Int JoinNonterminal::getWidth(const Assignment& assignment) const {
-  Int width = util::getDiff(preProjectionVars, assignment).size();
-  for (JoinNode* child : children) {
-    width = max(width, child->getWidth(assignment));
-  }
-  return width;
-}
-
-void JoinNonterminal::updateVarSizes(Map<Int, size_t>& varSizes, const Cnf& cnf) const {
-  for (Int var : preProjectionVars) {
-    varSizes[var] = max(varSizes[var], preProjectionVars.size());
-  }
-  for (JoinNode* child : children) {
-    child->updateVarSizes(varSizes, cnf);
-  }
-}
-
-vector<Int> JoinNonterminal::getBiggestNodeVarOrder(const Cnf& cnf) const {
-  Map<Int, size_t> varSizes; // var x |-> size of biggest node containing x
-  for (Int var : cnf.apparentVars) {
-    varSizes[var] = 0;
-  }
-
-  updateVarSizes(varSizes, cnf);
-
-  multimap<size_t, Int, greater<size_t>> sizedVars = dpve::util::flipMap(varSizes); // size |-> var
-
-  size_t prevSize = 0;
-
-  if (verboseSolving >= 2) {
-    cout << DASH_LINE;
-  }
-
-  vector<Int> varOrder;
-  for (const auto& [varSize, var] : sizedVars) {
-    varOrder.push_back(var);
-
-    if (verboseSolving >= 2) {
-      if (prevSize == varSize) {
-        cout << " " << var;
-      }
-      else {
-        if (prevSize > 0) {
-          cout << "\n";
-        }
-        prevSize = varSize;
-        cout << "c vars in nodes of size " << std::right << std::setw(5) << varSize << ": " << var;
-      }
-    }
+  for (const JoinNonterminal* node : getNonterminalPostOrder()) {
+    node->printNode(startWord);
   }
-
-  if (verboseSolving >= 2) {
-    cout << "\n" << DASH_LINE;
-  }
-
-  return varOrder;
 }
 
-vector<Int> JoinNonterminal::getHighestNodeVarOrder() const {
-  vector<Int> varOrder;
-  std::queue<const JoinNonterminal*> q;
-  q.push(this);
-  while (!q.empty()) {
-    const JoinNonterminal* n = q.front();
-    q.pop();
-    for (Int var : n->projectionVars) {
-      varOrder.push_back(var);
+void JoinNonterminal::encodeSubtree(string& bytes) const {
+  for (const JoinNonterminal* node : getNonterminalPostOrder()) {
+    util::appendVarint(bytes, node->nodeIndex + 1);
+    util::appendVarint(bytes, node->children.size());
+    for (const JoinNode* child : node->children) {
+      util::appendVarint(bytes, child->nodeIndex + 1);
     }
-    for (const JoinNode* child : n->children) {
-      if (!child->isTerminal()) {
-        q.push(static_cast<const JoinNonterminal*>(child));
-      }
+    util::appendVarint(bytes, node->projectionVars.size());
+    for (Int var : node->projectionVars) {
+      util::appendVarint(bytes, var);
     }
   }
-  return varOrder;
 }
 
-vector<Int> JoinNonterminal::getLexPVarOrder(const Cnf& cnf) const {
-  Set<Int> processedVars;
-  vector<Int> varOrder;
-  Graph fullPrimalGraph = cnf.getPrimalGraph();
-  vector<Int> tiebreakerinv = cnf.getMostClausesVarOrder();
-  Map<Int, Int> tiebreaker;
-  for (Int i = 0; i<tiebreakerinv.size(); i++){
-    tiebreaker[tiebreakerinv[i]] = i; 
-  }
-  std::queue<const JoinNonterminal*> q;
-  q.push(this);
-  while (!q.empty()) {
-    const JoinNonterminal* n = q.front();
-    q.pop();
-    auto vo = n->getLexPVarRanking(fullPrimalGraph, processedVars, tiebreaker);
-    varOrder.insert(varOrder.end(),vo.begin(),vo.end());
-    for (const JoinNode* child : n->children) {
+vector<const JoinNonterminal*> JoinNonterminal::getNonterminalPostOrder() const {
+  vector<const JoinNonterminal*> postOrder;
+  vector<pair<const JoinNonterminal*, Int>> stack{{this, 0}}; // node, index of next child
+  while (!stack.empty()) {
+    auto [node, childIndex] = stack.back();
+    if (childIndex < node->children.size()) {
+      stack.back().second++;
+      const JoinNode* child = node->children.at(childIndex);
       if (!child->isTerminal()) {
-        q.push(static_cast<const JoinNonterminal*>(child));
+        stack.push_back({static_cast<const JoinNonterminal*>(child), 0});
       }
     }
-  }
-  return varOrder;
-}
-
-bool commp(const std::pair<Int,std::tuple<Label,Int>> a, const std::pair<Int,std::tuple<Label,Int>> b){
-  return a.second < b.second;
-}
-
-vector<Int> JoinNonterminal::getLexPVarRanking(Graph fullPrimalGraph, Set<Int>& processedVars, Map<Int, Int> tiebreaker) const {
-  Set<Int> varSet = util::getDiff(preProjectionVars, processedVars);
-  Map<Int, std::tuple<Label,Int>> unnumberedVertices;
-  for (Int vertex : varSet) {
-    unnumberedVertices[vertex] = {Label(),tiebreaker.at(vertex)};
-  }
-  vector<Int> numberedVertices; // whose alpha numbers are decreasing
-  Graph curGraph = fullPrimalGraph.projectOnto(varSet);
-  for (Int number = varSet.size(); number > 0; number--) {
-    Int vertex = max_element(unnumberedVertices.begin(), unnumberedVertices.end(), commp)->first; // ignores label
-    numberedVertices.push_back(vertex);
-    unnumberedVertices.erase(vertex);
-    for (Int neighbor : curGraph.adjacencyMap.at(vertex)) {
-      auto unnumberedNeighborIt = unnumberedVertices.find(neighbor);
-      if (unnumberedNeighborIt != unnumberedVertices.end()) {
-        Int unnumberedNeighbor = unnumberedNeighborIt->first;
-        std::get<0>(unnumberedVertices.at(unnumberedNeighbor)).addNumber(number);
-      }
+    else {
+      postOrder.push_back(node);
+      stack.pop_back();
     }
   }
-  processedVars.insert(varSet.begin(),varSet.end());
-  return numberedVertices;
+  return postOrder;
 }
 
-vector<Int> JoinNonterminal::getVarOrder(Int varOrderHeuristic, const Cnf& cnf) const {
-  if (CNF_VAR_ORDER_HEURISTICS.contains(abs(varOrderHeuristic))) {
-    return cnf.getCnfVarOrder(varOrderHeuristic);
-  }
-
-  vector<Int> varOrder;
-  if (abs(varOrderHeuristic) == dpve::BIGGEST_NODE_HEURISTIC) { // 8
-    varOrder = getBiggestNodeVarOrder(cnf);
-  } else if (abs(varOrderHeuristic)== 10){
-    varOrder = getLexPVarOrder(cnf);
-  } else {
-    assert(abs(varOrderHeuristic) == HIGHEST_NODE_HEURISTIC); //9
-    varOrder = getHighestNodeVarOrder();
-  }
-
-  if (varOrderHeuristic < 0) {
-    reverse(varOrder.begin(), varOrder.end());
-  }
-
-  return varOrder;
-}
-
-vector<Assignment> JoinNonterminal::getOuterAssignments(Int varOrderHeuristic, Int sliceVarCount, const Cnf& cnf) const {
-  if (sliceVarCount <= 0) {
-    return {Assignment()};
-  }
-
-  TimePoint sliceVarOrderStartPoint = util::getTimePoint();
-  vector<Int> varOrder = getVarOrder(varOrderHeuristic, cnf);
-  if (verboseSolving >= 1) {
-    io::printRow("sliceVarSeconds", util::getDuration(sliceVarOrderStartPoint));
-  }
-
-  TimePoint assignmentsStartPoint = util::getTimePoint();
-  vector<Assignment> assignments;
-
-  if (verboseSolving >= 2) {
-    cout << "c slice var order heuristic: {";
-  }
-
-  for (Int i = 0, assignedVars = 0; i < varOrder.size() && assignedVars < sliceVarCount; i++) {
-    Int var = varOrder.at(i);
-    if (cnf.outerVars.contains(var)) {
-      assignments = Assignment::getExtendedAssignments(assignments, var);
-      assignedVars++;
-      if (verboseSolving >= 2) {
-        cout << " " << var;
+Int JoinNonterminal::getWidth(const Assignment& assignment) const {
+  Int width = 0;
+  for (const JoinNonterminal* node : getNonterminalPostOrder()) {
+    width = max(width, static_cast<Int>(util::getDiff(node->preProjectionVars, assignment).size()));
+    for (const JoinNode* child : node->children) {
+      if (child->isTerminal()) {
+        width = max(width, child->getWidth(assignment));
       }
     }
   }
-
-  if (verboseSolving >= 2) {
-    cout << " }\n";
-  }
-
-  if (verboseSolving >= 1) {
-    dpve::io::printRow("sliceAssignmentsSeconds", dpve::util::getDuration(assignmentsStartPoint));
-  }
-
-  return assignments;
+  return width;
 }
 
-JoinNonterminal::JoinNonterminal(const vector<JoinNode*>& children, const Set<Int>& projectionVars, Int requestedNodeIndex) {
+JoinNonterminal::JoinNonterminal(const vector<JoinNode*>& children, const Set<Int>& projectionVars) {
   this->children = children;
   this->projectionVars = projectionVars;
 
-  if (requestedNodeIndex == MIN_INT) {
-    requestedNodeIndex = nodeCount;
-  }
-  else if (requestedNodeIndex < terminalCount) {
-    throw MyError("requestedNodeIndex == ", requestedNodeIndex, " < ", terminalCount, " == terminalCount");
-  }
-  else if (nonterminalIndices.contains(requestedNodeIndex)) {
-    throw MyError("requestedNodeIndex ", requestedNodeIndex, " already taken");
-  }
-
-  nodeIndex = requestedNodeIndex;
-  nonterminalIndices.insert(nodeIndex);
+  nodeIndex = nodeCount;
   nodeCount++;
 
-  for (JoinNode* child : children) {
-    util::unionize(preProjectionVars, child->getPostProjectionVars());
+  for (JoinNode* child : children) { // post-projection vars of children, without temporary sets
+    for (Int var : child->preProjectionVars) {
+      if (!child->projectionVars.contains(var)) {
+        preProjectionVars.insert(var);
+      }
+    }
   }
 }
-
-
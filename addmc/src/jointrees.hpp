@@ -5,15 +5,11 @@
 #include "graph.hpp"
 
 namespace dpve{
-class JoinNode { // abstract
+class JoinNode { // abstract; built by planners
 public:
-  static Int nodeCount;
-  static Int terminalCount;
-  static Set<Int> nonterminalIndices;
-
-  static Int backupNodeCount;
-  static Int backupTerminalCount;
-  static Set<Int> backupNonterminalIndices;
+  /* per thread so that several planners can build join trees concurrently: */
+  static thread_local Int nodeCount;
+  static thread_local Int terminalCount;
 
   // static Cnf cnf; // this field must be set exactly once before any JoinNode object is constructed
 
@@ -22,18 +18,10 @@ public:
   Set<Int> projectionVars; // empty for JoinTerminal
   Set<Int> preProjectionVars; // set by constructor
 
-  void* dd = 0; // for sampling. void* type so as to avoid circular dependency with class Dd definition in dmc.hh
-
-  static void resetStaticFields(); // backs up and re-initializes static fields
-  static void restoreStaticFields(); // from backup
+  static void resetStaticFields(); // re-initializes static fields
 
   virtual Int getWidth(const Assignment& assignment = Assignment()) const = 0; // of subtree
 
-  virtual void updateVarSizes(
-    Map<Int, size_t>& varSizes, // var x |-> size of biggest node containing x
-    const Cnf& cnf
-  ) const = 0;
-
   Set<Int> getPostProjectionVars() const;
   Int chooseClusterIndex(
     Int clusterIndex, // of this node
@@ -51,52 +39,74 @@ class JoinTerminal : public JoinNode {
 public:
   Int getWidth(const Assignment& assignment = Assignment()) const override;
 
-  void updateVarSizes(Map<Int, size_t>& varSizes, const Cnf& cnf) const override;
-
   JoinTerminal(const Cnf& cnf);
 };
 
 class JoinNonterminal : public JoinNode {
 public:
-  Int verboseSolving = 0;
   void printNode(const string& startWord) const; // 1-indexing
   void printSubtree(const string& startWord = "") const; // post-order traversal
+  void encodeSubtree(string& bytes) const; // post-order traversal; per node: index, child count, children, var count, vars (as varints, 1-indexing)
 
+  vector<const JoinNonterminal*> getNonterminalPostOrder() const; // of subtree, without recursion so that deep trees do not overflow stack
   Int getWidth(const Assignment& assignment = Assignment()) const override;
 
-  void updateVarSizes(Map<Int, size_t>& varSizes, const Cnf& cnf) const override;
-  vector<Int> getBiggestNodeVarOrder(const Cnf& cnf) const;
-  vector<Int> getHighestNodeVarOrder() const;
-  vector<Int> getLexPVarOrder(const Cnf& cnf) const;
-  vector<Int> getLexPVarRanking(Graph fullPrimalGraph,Set<Int>& processedVars, Map<Int, Int> tiebreaker) const;
-  vector<Int> getVarOrder(Int varOrderHeuristic, const Cnf& cnf) const;
-
-  vector<Assignment> getOuterAssignments(Int varOrderHeuristic, Int sliceVarCount, const Cnf& cnf) const;
-
   JoinNonterminal(
     const vector<JoinNode*>& children,
-    const Set<Int>& projectionVars = Set<Int>(),
-    Int requestedNodeIndex = MIN_INT
+    const Set<Int>& projectionVars = Set<Int>()
   );
 };
 
-class JoinTree { // for JoinTreeProcessor
+class JoinTree { // flat, for executor: node arrays (terminals first, terminal index = clause index) with children and vars in compressed sparse rows
 public:
   Int declaredVarCount = MIN_INT;
   Int declaredClauseCount = MIN_INT;
   Int declaredNodeCount = MIN_INT;
 
-  Map<Int, JoinTerminal*> joinTerminals; // 0-indexing
-  Map<Int, JoinNonterminal*> joinNonterminals; // 0-indexing
+  vector<Int> childOffsets; // node |-> index in `children` of first child; last entry is `children.size()`
+  vector<Int> children; // 0-indexing
+  vector<Int> projectionVarOffsets; // node |-> index in `projectionVars` of first var; last entry is `projectionVars.size()`
+  vector<Int> projectionVars; // ascending for each node; none for terminals
+  vector<Int> preProjectionVarOffsets; // node |-> index in `preProjectionVars` of first var; last entry is `preProjectionVars.size()`
+  vector<Int> preProjectionVars; // ascending for each node: clause vars of terminal, post-projection vars of children of nonterminal
+  vector<Int> postOrder; // nodes of root subtree, children in order before parent (slots of DDs are indexed by node)
 
   Int width = MIN_INT; // width of latest join tree
   Float plannerDuration = 0; // cumulative time for all join trees, in seconds
+  Int verboseSolving = 0;
+
+  Int getRoot() const; // last node
+  bool isTerminal(Int node) const;
+  std::span<const Int> getChildren(Int node) const;
+  std::span<const Int> getProjectionVars(Int node) const;
+  std::span<const Int> getPreProjectionVars(Int node) const;
+  Int getWidth(const Assignment& assignment = Assignment()) const; // of root subtree
+  void printTree(std::ostream& out = std::cout, const string& startWord = "c ", const vector<Int>& clauseRanks = {}) const; // in planner-executor format, with terminals renumbered by nonempty clauseRanks
 
-  JoinNode* getJoinNode(Int nodeIndex) const; // 0-indexing
-  JoinNonterminal* getJoinRoot() const;
-  void printTree() const;
+  Int getNonterminalCount() const; // added so far
+  bool hasNonterminal(Int node) const;
+  void addNonterminal(Int node, const vector<Int>& nodeChildren, vector<Int> nodeProjectionVars); // nodes in any order; vars possibly unsorted
+  void finish(const Cnf& cnf); // after all nonterminals are added: sorts them into node arrays and sets pre-projection vars and post order
+
+  vector<Int> getBiggestNodeVarOrder(const Cnf& cnf) const;
+  vector<Int> getHighestNodeVarOrder() const;
+  vector<Int> getLexPVarOrder(const Cnf& cnf) const;
+  vector<Int> getVarOrder(Int varOrderHeuristic, const Cnf& cnf) const;
+
+  vector<Assignment> getOuterAssignments(Int varOrderHeuristic, Int sliceVarCount, const Cnf& cnf) const;
 
   JoinTree(Int declaredVarCount, Int declaredClauseCount, Int declaredNodeCount);
+  JoinTree(const JoinNonterminal* root, Int declaredVarCount, Int declaredClauseCount, Int declaredNodeCount, const Cnf& cnf); // flattens tree of in-process planner
+
+private:
+  /* nonterminals in order of addition, before `finish`: */
+  vector<Int> nodeRows; // node |-> row, or -1 for node not added
+  vector<Int> rowChildOffsets{0};
+  vector<Int> rowChildren;
+  vector<Int> rowVarOffsets{0};
+  vector<Int> rowVars;
+
+  vector<Int> getLexPVarRanking(Int node, const Graph& primalGraph, vector<Int>& localIds, vector<bool>& processedVars, const Map<Int, Int>& tiebreaker) const;
 };
 
 class JoinTreeProcessor {
@@ -108,12 +118,15 @@ public:
   static Int verboseJoinTree;
   
   const Cnf& cnf;
+  std::istream& input; // stdin or cache file
+  const vector<Int> clauseIndices; // canonical clause rank |-> clause index, for terminals of cache file; empty for stdin
 
   Int lineIndex = 0;
   Int problemLineIndex = MIN_INT;
   Int joinTreeEndLineIndex = MIN_INT;
 
   static void killPlanner(); // sends SIGKILL
+  static void killPlannerOnStdin(); // reads stdin up to pid line of planner, whose join tree is not needed
 
   /* timer: */
   static void handleSigAlrm(int signal); // kills planner after receiving SIGALRM
@@ -122,15 +135,34 @@ public:
   static void armTimer(Float seconds); // schedules SIGALRM
   static void disarmTimer(); // in case stdin ends before timer expires
 
-  const JoinNonterminal* getJoinTreeRoot() const;
+  const JoinTree* getJoinTree() const;
 
   void processCommentLine(const vector<string>& words);
-  void processProblemLine(const vector<string>& words);
-  void processNonterminalLine(const vector<string>& words);
+  void processProblemLine(const vector<string>& words); // also reads binary nonterminals after problem line
+  void processNonterminalLine(std::string_view line);
+  void processBinaryNonterminals(std::string_view bytes);
+  void addNonterminal(Int parentIndex, vector<Int> childIndices, const vector<Int>& projectionVars); // 0-indexing
 
   void finishReadingJoinTree();
   void readInputStream();
 
-  JoinTreeProcessor(Float plannerWaitDuration, const Cnf& cnf);
+  void chooseJoinTree(); // latest or narrower backup join tree
+
+  JoinTreeProcessor(Float plannerWaitDuration, const Cnf& cnf); // from planner process via stdin
+  JoinTreeProcessor(std::istream& input, const Cnf& cnf, const vector<Int>& clauseIndices); // from cache file, without timer
+};
+
+class JoinTreeCache { // on disk, for repeated runs on the same formula: one file per formula hash, holding narrowest join tree so far
+public:
+  const string filePath; // empty if caching is off
+  vector<Int> clauseIndices; // canonical clause rank |-> clause index, as file is shared by formulas with reordered clauses
+  vector<Int> clauseRanks; // inverse of clauseIndices
+
+  bool hasJoinTree() const;
+  Int getCachedWidth() const; // MAX_INT if no join tree is cached
+  const JoinTree* loadJoinTree(const Cnf& cnf) const;
+  bool storeJoinTree(const JoinTree& joinTree) const; // unless cached join tree is at most as wide; returns whether stored
+
+  JoinTreeCache(const string& cacheDir, const Cnf& cnf); // empty cacheDir turns caching off
 };
 } //end namespace dpve
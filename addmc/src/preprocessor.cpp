@@ -0,0 +1,509 @@
+#include "preprocessor.hpp"
+#include "io.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+using dpve::Int;
+using dpve::Number;
+using dpve::Preprocessor;
+using dpve::io::printRow;
+using std::to_string;
+
+/* class Preprocessor ======================================================= */
+
+Int Preprocessor::getKey(Int literal) {
+  return 2 * abs(literal) + (literal < 0);
+}
+
+bool Preprocessor::normalize(vector<Int>& literals) {
+  std::sort(literals.begin(), literals.end(), [](Int a, Int b) { return getKey(a) < getKey(b); });
+  literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+  for (Int i = 1; i < literals.size(); i++) {
+    if (literals[i] == -literals[i - 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Int Preprocessor::getValue(Int literal) const {
+  Int value = values.at(abs(literal));
+  return literal > 0 ? value : -value;
+}
+
+bool Preprocessor::isFree(Int var) const {
+  return values.at(var) == 0 && substitutes.at(var) == 0 && !eliminatedVars.at(var);
+}
+
+bool Preprocessor::hasLiteral(Int clauseIndex, Int literal) const {
+  const vector<Int>& literals = clauseLiterals.at(clauseIndex);
+  return !removedClauses.at(clauseIndex) && std::find(literals.begin(), literals.end(), literal) != literals.end();
+}
+
+bool Preprocessor::hasBinaryOccurrence(Int literal) const {
+  for (Int clauseIndex : occurrences.at(getKey(literal))) {
+    if (clauseLiterals.at(clauseIndex).size() == 2 && hasLiteral(clauseIndex, literal)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+vector<Int> Preprocessor::getLiveOccurrences(Int literal) {
+  vector<Int>& clauseIndices = occurrences.at(getKey(literal));
+  std::sort(clauseIndices.begin(), clauseIndices.end()); // a literal removed and later put back is listed twice
+  clauseIndices.erase(std::unique(clauseIndices.begin(), clauseIndices.end()), clauseIndices.end());
+  clauseIndices.erase(std::remove_if(clauseIndices.begin(), clauseIndices.end(), [this, literal](Int clauseIndex) {
+    return !hasLiteral(clauseIndex, literal);
+  }), clauseIndices.end());
+  return clauseIndices;
+}
+
+void Preprocessor::addClause(vector<Int> literals) {
+  if (!normalize(literals)) {
+    removedClauseCount++;
+    return;
+  }
+  if (literals.empty()) {
+    conflicting = true;
+    return;
+  }
+  Int clauseIndex = clauseLiterals.size();
+  for (Int literal : literals) {
+    occurrences.at(getKey(literal)).push_back(clauseIndex);
+  }
+  if (literals.size() == 1) {
+    unitQueue.push_back(literals.front());
+  }
+  clauseLiterals.push_back(std::move(literals));
+  removedClauses.push_back(false);
+}
+
+void Preprocessor::removeClause(Int clauseIndex) {
+  removedClauses.at(clauseIndex) = true;
+  clauseLiterals.at(clauseIndex) = vector<Int>(); // occurrences become stale
+}
+
+void Preprocessor::removeLiteral(Int clauseIndex, Int literal) {
+  vector<Int>& literals = clauseLiterals.at(clauseIndex);
+  literals.erase(std::find(literals.begin(), literals.end(), literal));
+  if (literals.size() == 1) {
+    unitQueue.push_back(literals.front());
+  }
+  else if (literals.empty()) {
+    conflicting = true;
+  }
+}
+
+bool Preprocessor::propagateUnits() {
+  while (!unitQueue.empty() && !conflicting) {
+    Int literal = unitQueue.back();
+    unitQueue.pop_back();
+    Int value = getValue(literal);
+    if (value > 0) {
+      continue;
+    }
+    if (value < 0) {
+      conflicting = true;
+      break;
+    }
+    values.at(abs(literal)) = literal > 0 ? 1 : -1;
+    fixedVarCount++;
+    for (Int clauseIndex : getLiveOccurrences(literal)) {
+      removeClause(clauseIndex);
+      removedClauseCount++;
+    }
+    for (Int clauseIndex : getLiveOccurrences(-literal)) {
+      removeLiteral(clauseIndex, -literal);
+    }
+  }
+  unitQueue.clear();
+  return !conflicting;
+}
+
+bool Preprocessor::probe(Int literal, Int& visitBudget) {
+  vector<Int> trail{literal}; // assumed and implied literals, unassigned again before returning
+  values.at(abs(literal)) = literal > 0 ? 1 : -1;
+  bool conflict = false;
+  for (Int i = 0; i < trail.size() && !conflict && visitBudget > 0; i++) {
+    for (Int clauseIndex : occurrences.at(getKey(-trail[i]))) { // stale entries are harmless, since any clause must hold
+      if (removedClauses.at(clauseIndex)) {
+        continue;
+      }
+      visitBudget -= clauseLiterals.at(clauseIndex).size();
+      Int unassignedCount = 0;
+      Int unassignedLiteral = 0;
+      bool satisfied = false;
+      for (Int l : clauseLiterals.at(clauseIndex)) {
+        Int value = getValue(l);
+        if (value > 0) {
+          satisfied = true;
+          break;
+        }
+        if (value == 0) {
+          unassignedCount++;
+          unassignedLiteral = l;
+        }
+      }
+      if (satisfied || unassignedCount > 1) {
+        continue;
+      }
+      if (unassignedCount == 0) {
+        conflict = true;
+        break;
+      }
+      values.at(abs(unassignedLiteral)) = unassignedLiteral > 0 ? 1 : -1;
+      trail.push_back(unassignedLiteral);
+    }
+  }
+  for (Int l : trail) {
+    values.at(abs(l)) = 0;
+  }
+  return conflict;
+}
+
+bool Preprocessor::probeFailedLiterals() {
+  Int fixedVarCountBefore = fixedVarCount;
+  Int visitBudget = 10 * clauseLiterals.size() + 1000000; // probing is quadratic in the worst case
+  for (Int var = 1; var <= cnf.declaredVarCount && visitBudget > 0 && !conflicting; var++) {
+    for (Int literal : {var, -var}) {
+      if (!isFree(var) || !hasBinaryOccurrence(-literal)) { // else assuming literal implies nothing
+        continue;
+      }
+      if (probe(literal, visitBudget)) {
+        unitQueue.push_back(-literal);
+        propagateUnits();
+      }
+    }
+  }
+  return fixedVarCount > fixedVarCountBefore;
+}
+
+bool Preprocessor::substituteEquivalentLiterals() {
+  Int nodeCount = 2 * (cnf.declaredVarCount + 1); // literal keys
+  vector<vector<Int>> implications(nodeCount);
+  for (Int clauseIndex = 0; clauseIndex < clauseLiterals.size(); clauseIndex++) {
+    const vector<Int>& literals = clauseLiterals[clauseIndex];
+    if (!removedClauses[clauseIndex] && literals.size() == 2) {
+      implications.at(getKey(-literals[0])).push_back(getKey(literals[1]));
+      implications.at(getKey(-literals[1])).push_back(getKey(literals[0]));
+    }
+  }
+
+  /* strongly connected components by Tarjan's algorithm, without recursion: */
+  vector<Int> indices(nodeCount, -1);
+  vector<Int> lowLinks(nodeCount);
+  vector<Int> components(nodeCount, -1);
+  vector<bool> onStack(nodeCount, false);
+  vector<Int> stack;
+  vector<pair<Int, Int>> callStack; // (node, index of next implication)
+  Int nextIndex = 0;
+  Int componentCount = 0;
+  for (Int root = 0; root < nodeCount; root++) {
+    if (indices[root] >= 0 || implications[root].empty()) {
+      continue;
+    }
+    indices[root] = lowLinks[root] = nextIndex++;
+    stack.push_back(root);
+    onStack[root] = true;
+    callStack.push_back({root, 0});
+    while (!callStack.empty()) {
+      Int node = callStack.back().first;
+      Int i = callStack.back().second++;
+      if (i < implications[node].size()) {
+        Int next = implications[node][i];
+        if (indices[next] < 0) {
+          indices[next] = lowLinks[next] = nextIndex++;
+          stack.push_back(next);
+          onStack[next] = true;
+          callStack.push_back({next, 0});
+        }
+        else if (onStack[next]) {
+          lowLinks[node] = std::min(lowLinks[node], indices[next]);
+        }
+        continue;
+      }
+      if (lowLinks[node] == indices[node]) {
+        Int member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          onStack[member] = false;
+          components[member] = componentCount;
+        } while (member != node);
+        componentCount++;
+      }
+      callStack.pop_back();
+      if (!callStack.empty()) {
+        Int parent = callStack.back().first;
+        lowLinks[parent] = std::min(lowLinks[parent], lowLinks[node]);
+      }
+    }
+  }
+
+  /* representative of component: outer var if any, so that no outer var is replaced by an inner one, then least var; mirrored components get negated representatives */
+  vector<Int> representatives(componentCount, 0);
+  for (Int var = 1; var <= cnf.declaredVarCount; var++) {
+    if (components[getKey(var)] < 0) {
+      continue;
+    }
+    if (components[getKey(var)] == components[getKey(-var)]) {
+      conflicting = true;
+      return false;
+    }
+    for (Int literal : {var, -var}) {
+      Int& representative = representatives[components[getKey(literal)]];
+      if (representative == 0 || (cnf.outerVars.contains(var) && !cnf.outerVars.contains(abs(representative)))) {
+        representative = literal;
+      }
+    }
+  }
+
+  Int substitutedVarCountBefore = substitutedVarCount;
+  for (Int var = 1; var <= cnf.declaredVarCount && !conflicting; var++) {
+    if (components[getKey(var)] < 0 || !isFree(var)) {
+      continue;
+    }
+    Int representative = representatives[components[getKey(var)]];
+    if (abs(representative) == var) {
+      continue;
+    }
+    substitutes.at(var) = representative;
+    substitutedVarCount++;
+
+    /* weights of var move to representative; var is left hidden with factor 1: */
+    cnf.literalWeights.at(representative) *= cnf.literalWeights.at(var);
+    cnf.literalWeights.at(-representative) *= cnf.literalWeights.at(-var);
+    cnf.literalWeights.at(var) = Number("1");
+    cnf.literalWeights.at(-var) = Number("0");
+
+    for (Int literal : {var, -var}) {
+      for (Int clauseIndex : getLiveOccurrences(literal)) {
+        vector<Int> literals = clauseLiterals.at(clauseIndex);
+        std::replace(literals.begin(), literals.end(), literal, literal > 0 ? representative : -representative);
+        removeClause(clauseIndex);
+        addClause(literals);
+      }
+    }
+  }
+  propagateUnits();
+  return substitutedVarCount > substitutedVarCountBefore;
+}
+
+bool Preprocessor::subsumeClauses() {
+  Int removedClauseCountBefore = removedClauseCount;
+  Int strengthenedClauseCountBefore = strengthenedClauseCount;
+  vector<Int> subsumers; // shorter clauses first
+  for (Int clauseIndex = 0; clauseIndex < clauseLiterals.size(); clauseIndex++) {
+    if (!removedClauses[clauseIndex]) {
+      subsumers.push_back(clauseIndex);
+    }
+  }
+  std::stable_sort(subsumers.begin(), subsumers.end(), [this](Int a, Int b) { return clauseLiterals[a].size() < clauseLiterals[b].size(); });
+
+  vector<bool> marks(2 * (cnf.declaredVarCount + 1), false); // literals of subsumer
+  Int visitBudget = 10 * clauseLiterals.size() + 1000000;
+  for (Int clauseIndex : subsumers) {
+    if (conflicting || visitBudget <= 0) {
+      break;
+    }
+    if (removedClauses[clauseIndex]) {
+      continue;
+    }
+    const vector<Int> literals = clauseLiterals[clauseIndex]; // copied, since subsumed clauses are modified below
+    Int pivot = literals.front(); // var with fewest occurrences
+    for (Int literal : literals) {
+      if (occurrences[getKey(literal)].size() + occurrences[getKey(-literal)].size() < occurrences[getKey(pivot)].size() + occurrences[getKey(-pivot)].size()) {
+        pivot = literal;
+      }
+    }
+    for (Int literal : literals) {
+      marks[getKey(literal)] = true;
+    }
+    for (Int pivotLiteral : {pivot, -pivot}) {
+      for (Int otherIndex : getLiveOccurrences(pivotLiteral)) {
+        const vector<Int>& otherLiterals = clauseLiterals[otherIndex];
+        if (otherIndex == clauseIndex || removedClauses[otherIndex] || otherLiterals.size() < literals.size()) {
+          continue;
+        }
+        visitBudget -= otherLiterals.size();
+        Int matchCount = 0;
+        Int flippedCount = 0;
+        Int flippedLiteral = 0;
+        for (Int l : otherLiterals) {
+          if (marks[getKey(l)]) {
+            matchCount++;
+          }
+          else if (marks[getKey(-l)]) {
+            flippedCount++;
+            flippedLiteral = l;
+          }
+        }
+        if (matchCount == literals.size()) {
+          removeClause(otherIndex);
+          removedClauseCount++;
+        }
+        else if (flippedCount == 1 && matchCount + 1 == literals.size()) { // resolvent on flipped literal subsumes other clause
+          removeLiteral(otherIndex, flippedLiteral);
+          strengthenedClauseCount++;
+        }
+      }
+    }
+    for (Int literal : literals) {
+      marks[getKey(literal)] = false;
+    }
+  }
+  propagateUnits();
+  return removedClauseCount > removedClauseCountBefore || strengthenedClauseCount > strengthenedClauseCountBefore;
+}
+
+bool Preprocessor::eliminateVars() {
+  if (!cnf.projectedCounting) { // outer vars are counted, so only inner vars can be quantified away
+    return false;
+  }
+  vector<pair<Int, Int>> candidates; // (estimated resolvent count, var)
+  for (Int var = 1; var <= cnf.declaredVarCount; var++) {
+    if (isFree(var) && !cnf.outerVars.contains(var) && cnf.literalWeights.at(var) == cnf.literalWeights.at(-var)) { // inner var is maximized, so unequal weights would pick a side
+      candidates.push_back({occurrences[getKey(var)].size() * occurrences[getKey(-var)].size(), var});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  Int eliminatedVarCountBefore = eliminatedVarCount;
+  for (auto [estimate, var] : candidates) {
+    if (conflicting) {
+      break;
+    }
+    if (!isFree(var)) {
+      continue;
+    }
+    vector<Int> positiveClauses = getLiveOccurrences(var);
+    vector<Int> negativeClauses = getLiveOccurrences(-var);
+    if (positiveClauses.size() > MAX_ELIMINATION_OCCURRENCES || negativeClauses.size() > MAX_ELIMINATION_OCCURRENCES || (positiveClauses.empty() && negativeClauses.empty())) {
+      continue;
+    }
+    vector<vector<Int>> resolvents;
+    bool bounded = true; // no more clauses than before, none too long
+    for (Int positiveClause : positiveClauses) {
+      for (Int negativeClause : negativeClauses) {
+        vector<Int> resolvent;
+        for (Int literal : clauseLiterals[positiveClause]) {
+          if (literal != var) {
+            resolvent.push_back(literal);
+          }
+        }
+        for (Int literal : clauseLiterals[negativeClause]) {
+          if (literal != -var) {
+            resolvent.push_back(literal);
+          }
+        }
+        if (!normalize(resolvent)) {
+          continue;
+        }
+        resolvents.push_back(resolvent);
+        if (resolvent.size() > MAX_RESOLVENT_SIZE || resolvents.size() > positiveClauses.size() + negativeClauses.size()) {
+          bounded = false;
+          break;
+        }
+      }
+      if (!bounded) {
+        break;
+      }
+    }
+    if (!bounded) {
+      continue;
+    }
+    for (Int clauseIndex : positiveClauses) {
+      removeClause(clauseIndex);
+    }
+    for (Int clauseIndex : negativeClauses) {
+      removeClause(clauseIndex);
+    }
+    eliminatedVars.at(var) = true;
+    eliminatedVarCount++;
+    for (const vector<Int>& resolvent : resolvents) {
+      addClause(resolvent);
+    }
+    propagateUnits();
+  }
+  return eliminatedVarCount > eliminatedVarCountBefore;
+}
+
+void Preprocessor::writeBack() {
+  ClauseArena arena;
+  for (Int clauseIndex = 0; clauseIndex < clauseLiterals.size(); clauseIndex++) {
+    if (!removedClauses[clauseIndex]) {
+      arena.startClause(false);
+      for (Int literal : clauseLiterals[clauseIndex]) {
+        arena.insertLiteral(literal);
+      }
+      arena.finishClause();
+    }
+  }
+  cnf.clauses = std::move(arena);
+  cnf.apparentVars.clear();
+  cnf.setApparentVars();
+  cnf.primalGraph.reset();
+
+  for (Int var = 1; var <= cnf.declaredVarCount; var++) { // fixed var is left hidden with factor of its true literal
+    if (values[var] != 0) {
+      cnf.literalWeights.at(-values[var] * var) = Number("0");
+    }
+  }
+}
+
+void Preprocessor::preprocess() {
+  TimePoint preprocessStartPoint = util::getTimePoint();
+  if (cnf.xorClauseCount > 0) {
+    printRow("preprocessing", "skipped for XOR clauses");
+    return;
+  }
+  Int varCount = cnf.declaredVarCount;
+  values.assign(varCount + 1, 0);
+  substitutes.assign(varCount + 1, 0);
+  eliminatedVars.assign(varCount + 1, false);
+  occurrences.assign(2 * (varCount + 1), vector<Int>());
+  Int clauseCountBefore = cnf.clauses.size();
+  for (const Clause& clause : cnf.clauses) {
+    addClause(vector<Int>(clause.begin(), clause.end()));
+  }
+  Map<Int, Number> literalWeightsBefore = cnf.literalWeights; // restored if formula is not replaced
+
+  propagateUnits();
+  for (Int round = 0; round < MAX_ROUNDS && !conflicting; round++) {
+    bool changed = probeFailedLiterals();
+    changed |= substituteEquivalentLiterals();
+    changed |= subsumeClauses();
+    changed |= eliminateVars();
+    if (!changed) {
+      break;
+    }
+  }
+
+  Int clauseCountAfter = std::count(removedClauses.begin(), removedClauses.end(), false);
+  if (conflicting) {
+    cnf.literalWeights = literalWeightsBefore;
+    cnf.unsatisfiable = true;
+  }
+  else if (clauseCountAfter == 0) { // planners and executor expect at least one clause
+    cnf.literalWeights = literalWeightsBefore;
+    printRow("preprocessing", "kept formula, which would have no clauses");
+  }
+  else {
+    writeBack();
+  }
+
+  printRow("preprocessSeconds", util::getDuration(preprocessStartPoint));
+  printRow("preprocessUnsatisfiable", conflicting);
+  printRow("preprocessClauseCounts", to_string(clauseCountBefore) + " -> " + to_string(conflicting || clauseCountAfter == 0 ? clauseCountBefore : clauseCountAfter));
+  if (cnf.verboseCnf >= 1) {
+    printRow("fixedVarCount", fixedVarCount);
+    printRow("substitutedVarCount", substitutedVarCount);
+    printRow("eliminatedVarCount", eliminatedVarCount);
+    printRow("removedClauseCount", removedClauseCount);
+    printRow("strengthenedClauseCount", strengthenedClauseCount);
+  }
+}
+
+Preprocessor::Preprocessor(Cnf& cnf): cnf(cnf) {}
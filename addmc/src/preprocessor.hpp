@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.hpp"
+#include "formula.hpp"
+
+namespace dpve{
+class Preprocessor { // simplifies CNF in place before planning, keeping weighted (projected) count; removed vars become hidden vars whose weights give their factors
+public:
+  Int fixedVarCount = 0; // by unit propagation and failed literals
+  Int substitutedVarCount = 0; // by equivalent literals
+  Int eliminatedVarCount = 0; // inner vars, by bounded var elimination
+  Int removedClauseCount = 0; // satisfied, tautological or subsumed
+  Int strengthenedClauseCount = 0; // by self-subsuming resolution
+
+  void preprocess(); // sets cnf.unsatisfiable instead of simplifying if a conflict is found
+  Preprocessor(Cnf& cnf);
+
+private:
+  static const Int MAX_ROUNDS = 4;
+  static const Int MAX_ELIMINATION_OCCURRENCES = 10; // per literal
+  static const Int MAX_RESOLVENT_SIZE = 16;
+
+  Cnf& cnf;
+
+  vector<vector<Int>> clauseLiterals; // clause index |-> literals; empty for removed clause
+  vector<bool> removedClauses;
+  vector<vector<Int>> occurrences; // 2 * var + (literal < 0) |-> clause indices, possibly stale
+  vector<Int> values; // var |-> 0 if unassigned, else literal sign
+  vector<Int> substitutes; // var |-> equivalent literal that replaced var, or 0
+  vector<bool> eliminatedVars;
+  vector<Int> unitQueue;
+  bool conflicting = false;
+
+  static Int getKey(Int literal);
+  static bool normalize(vector<Int>& literals); // sorts by var and drops duplicates; false for tautology
+  Int getValue(Int literal) const; // +1 if true, -1 if false, 0 if unassigned
+  bool isFree(Int var) const; // unassigned, unsubstituted and not eliminated
+  bool hasLiteral(Int clauseIndex, Int literal) const;
+  bool hasBinaryOccurrence(Int literal) const;
+  vector<Int> getLiveOccurrences(Int literal); // of unremoved clauses that still have literal; also drops stale entries
+
+  void addClause(vector<Int> literals); // drops duplicates, skips tautology
+  void removeClause(Int clauseIndex);
+  void removeLiteral(Int clauseIndex, Int literal);
+  bool propagateUnits(); // false on conflict
+
+  bool probeFailedLiterals(); // whether a literal was fixed
+  bool probe(Int literal, Int& visitBudget); // whether assuming literal leads to a conflict by unit propagation
+  bool substituteEquivalentLiterals(); // from strongly connected components of binary implication graph
+  bool subsumeClauses(); // also self-subsuming resolution
+  bool eliminateVars(); // inner vars whose literal weights are equal, so that existential quantification keeps the count
+
+  void writeBack(); // into cnf: clauses, apparent vars, literal weights of removed vars
+};
+} //end namespace dpve
@@ -1,11 +1,32 @@
 #include "util.hpp"
 #include "io.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
 #include <iterator>
+#include <linux/perf_event.h>
+#include <lzma.h>
+#include <mutex>
 #include <sstream>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef ZSTD
+#include <zstd.h>
+#endif
 
 using dpve::Int;
 using dpve::TimePoint;
 using dpve::Float;
+using dpve::util::MyError;
 
 using std::istream_iterator;
 
@@ -30,6 +51,381 @@ vector<string> dpve::util::splitInputLine(const string& line) {
   return words;
 }
 
+std::string_view dpve::util::getNextWord(std::string_view& text) {
+  size_t start = 0;
+  while (start < text.size() && isspace(static_cast<unsigned char>(text[start]))) {
+    start++;
+  }
+  size_t end = start;
+  while (end < text.size() && !isspace(static_cast<unsigned char>(text[end]))) {
+    end++;
+  }
+  std::string_view word = text.substr(start, end - start);
+  text.remove_prefix(end);
+  return word;
+}
+
+Int dpve::util::parseInt(std::string_view word) {
+  size_t i = 0;
+  bool negative = false;
+  if (i < word.size() && (word[i] == '-' || word[i] == '+')) {
+    negative = word[i] == '-';
+    i++;
+  }
+  if (i == word.size()) {
+    throw MyError("invalid integer '", word, "'");
+  }
+  if (word.size() - i > 18) { // may overflow
+    return stoll(string(word));
+  }
+
+  Int value = 0;
+  for (; i < word.size(); i++) {
+    char c = word[i];
+    if (c < '0' || c > '9') {
+      throw MyError("invalid integer '", word, "'");
+    }
+    value = value * 10 + (c - '0');
+  }
+  return negative ? -value : value;
+}
+
+void dpve::util::appendVarint(string& bytes, Int num) {
+  assert(num >= 0);
+  uint64_t rest = num;
+  while (rest >= 0x80) {
+    bytes.push_back(static_cast<char>((rest & 0x7f) | 0x80));
+    rest >>= 7;
+  }
+  bytes.push_back(static_cast<char>(rest));
+}
+
+Int dpve::util::readVarint(std::string_view& bytes) {
+  uint64_t num = 0;
+  for (Int shift = 0; shift < 64; shift += 7) {
+    if (bytes.empty()) {
+      throw MyError("truncated varint");
+    }
+    uint64_t byte = static_cast<unsigned char>(bytes.front());
+    bytes.remove_prefix(1);
+    num |= (byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return num;
+    }
+  }
+  throw MyError("varint longer than 64 bits");
+}
+
+void dpve::util::mixHash(uint64_t& hash, Int word) {
+  for (Int byte = 0; byte < sizeof(word); byte++) {
+    hash = (hash ^ ((word >> (8 * byte)) & 0xff)) * 1099511628211ull;
+  }
+}
+
+void dpve::util::mixHash(uint64_t& hash, std::string_view bytes) {
+  mixHash(hash, Int(bytes.size()));
+  for (char byte : bytes) {
+    hash = (hash ^ static_cast<unsigned char>(byte)) * 1099511628211ull;
+  }
+}
+
+string dpve::util::getHexString(uint64_t hash) {
+  std::ostringstream stream;
+  stream << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return stream.str();
+}
+
+/* class Decoder =========================================================== */
+
+class dpve::util::Decoder {
+public:
+  virtual ~Decoder() = default;
+  virtual size_t decode(std::string_view& raw, bool rawEnded, char* out, size_t outSize) = 0; // consumes prefix of `raw`; returns count of bytes written to `out`
+  virtual bool isComplete() const = 0; // whether decoded data ends at stream boundary
+};
+
+namespace {
+  const size_t CHUNK_SIZE = 1 << 20;
+
+  const std::string_view GZIP_MAGIC("\x1f\x8b", 2);
+  const std::string_view XZ_MAGIC("\xfd" "7zXZ\0", 6);
+  const std::string_view ZSTD_MAGIC("\x28\xb5\x2f\xfd", 4);
+  const size_t MAGIC_SIZE = 6; // longest
+
+  class PlainDecoder : public dpve::util::Decoder { // for uncompressed file that is not mapped
+  public:
+    size_t decode(std::string_view& raw, bool, char* out, size_t outSize) override {
+      size_t count = std::min(raw.size(), outSize);
+      std::copy_n(raw.data(), count, out);
+      raw.remove_prefix(count);
+      return count;
+    }
+
+    bool isComplete() const override {
+      return true;
+    }
+  };
+
+  class GzipDecoder : public dpve::util::Decoder { // concatenated members are decoded like `gzip -d`
+  public:
+    GzipDecoder() {
+      if (inflateInit2(&stream, 15 + 16) != Z_OK) { // 16: gzip header
+        throw MyError("unable to initialize gzip decoder");
+      }
+    }
+
+    ~GzipDecoder() {
+      inflateEnd(&stream);
+    }
+
+    size_t decode(std::string_view& raw, bool, char* out, size_t outSize) override {
+      if (memberEnded && !raw.empty()) {
+        inflateReset(&stream);
+        memberEnded = false;
+      }
+      uInt inSize = std::min<size_t>(raw.size(), UINT_MAX); // zlib counts in 32 bits, but a mapped file can be bigger
+      outSize = std::min<size_t>(outSize, UINT_MAX);
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+      stream.avail_in = inSize;
+      stream.next_out = reinterpret_cast<Bytef*>(out);
+      stream.avail_out = outSize;
+
+      int status = inflate(&stream, Z_NO_FLUSH);
+      if (status == Z_STREAM_END) {
+        memberEnded = true;
+      }
+      else if (status != Z_OK && status != Z_BUF_ERROR) {
+        throw MyError("corrupt gzip data: ", stream.msg ? stream.msg : "unknown error");
+      }
+
+      raw.remove_prefix(inSize - stream.avail_in);
+      return outSize - stream.avail_out;
+    }
+
+    bool isComplete() const override {
+      return memberEnded;
+    }
+
+  private:
+    z_stream stream{};
+    bool memberEnded = false;
+  };
+
+  class XzDecoder : public dpve::util::Decoder {
+  public:
+    XzDecoder() {
+      if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        throw MyError("unable to initialize xz decoder");
+      }
+    }
+
+    ~XzDecoder() {
+      lzma_end(&stream);
+    }
+
+    size_t decode(std::string_view& raw, bool rawEnded, char* out, size_t outSize) override {
+      stream.next_in = reinterpret_cast<const uint8_t*>(raw.data());
+      stream.avail_in = raw.size();
+      stream.next_out = reinterpret_cast<uint8_t*>(out);
+      stream.avail_out = outSize;
+
+      lzma_ret status = lzma_code(&stream, rawEnded ? LZMA_FINISH : LZMA_RUN); // LZMA_CONCATENATED needs LZMA_FINISH to end
+      if (status == LZMA_STREAM_END) {
+        streamEnded = true;
+      }
+      else if (status != LZMA_OK && status != LZMA_BUF_ERROR) {
+        throw MyError("corrupt xz data: lzma_ret ", status);
+      }
+
+      raw.remove_prefix(raw.size() - stream.avail_in);
+      return outSize - stream.avail_out;
+    }
+
+    bool isComplete() const override {
+      return streamEnded;
+    }
+
+  private:
+    lzma_stream stream = LZMA_STREAM_INIT;
+    bool streamEnded = false;
+  };
+
+#ifdef ZSTD
+  class ZstdDecoder : public dpve::util::Decoder { // concatenated frames are decoded like `zstd -d`
+  public:
+    ZstdDecoder() {
+      stream = ZSTD_createDStream();
+      if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) {
+        throw MyError("unable to initialize zstd decoder");
+      }
+    }
+
+    ~ZstdDecoder() {
+      ZSTD_freeDStream(stream);
+    }
+
+    size_t decode(std::string_view& raw, bool rawEnded, char* out, size_t outSize) override {
+      ZSTD_inBuffer input{raw.data(), raw.size(), 0};
+      ZSTD_outBuffer output{out, outSize, 0};
+
+      size_t status = ZSTD_decompressStream(stream, &output, &input);
+      if (ZSTD_isError(status)) {
+        throw MyError("corrupt zstd data: ", ZSTD_getErrorName(status));
+      }
+      if (input.pos > 0 || output.pos > 0) {
+        frameEnded = status == 0; // frame fully decoded and flushed
+      }
+
+      raw.remove_prefix(input.pos);
+      return output.pos;
+    }
+
+    bool isComplete() const override {
+      return frameEnded;
+    }
+
+  private:
+    ZSTD_DStream* stream = nullptr;
+    bool frameEnded = false;
+  };
+#endif
+}
+
+/* class InputFile ========================================================== */
+
+dpve::util::InputFile::InputFile(const string& filePath) : filePath(filePath) {
+  fileDescriptor = open(filePath.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    throw MyError("unable to open file '", filePath, "'");
+  }
+
+  struct stat fileStatus;
+  if (fstat(fileDescriptor, &fileStatus) == 0 && S_ISREG(fileStatus.st_mode) && fileStatus.st_size > 0) {
+    void* address = mmap(nullptr, fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (address != MAP_FAILED) {
+      madvise(address, fileStatus.st_size, MADV_SEQUENTIAL);
+      mappedData = static_cast<const char*>(address);
+      mappedSize = fileStatus.st_size;
+    }
+  }
+
+  if (mappedData != nullptr) {
+    raw = std::string_view(mappedData, mappedSize);
+    rawEnded = true;
+  }
+  else {
+    while (raw.size() < MAGIC_SIZE && !rawEnded) {
+      readRaw();
+    }
+  }
+
+  if (raw.starts_with(GZIP_MAGIC)) {
+    compression = "gzip";
+    decoder = std::make_unique<GzipDecoder>();
+  }
+  else if (raw.starts_with(XZ_MAGIC)) {
+    compression = "xz";
+    decoder = std::make_unique<XzDecoder>();
+  }
+  else if (raw.starts_with(ZSTD_MAGIC)) {
+#ifdef ZSTD
+    compression = "zstd";
+    decoder = std::make_unique<ZstdDecoder>();
+#else
+    throw MyError("zstd-compressed file '", filePath, "' requires building with ZSTD=1");
+#endif
+  }
+  else if (mappedData != nullptr) {
+    text = raw;
+  }
+  else {
+    decoder = std::make_unique<PlainDecoder>();
+  }
+}
+
+dpve::util::InputFile::~InputFile() {
+  if (mappedData != nullptr) {
+    munmap(const_cast<char*>(mappedData), mappedSize);
+  }
+  close(fileDescriptor);
+}
+
+bool dpve::util::InputFile::getLine(std::string_view& line) {
+  size_t searchStart = 0;
+  size_t lineEnd;
+  while ((lineEnd = text.find('\n', searchStart)) == std::string_view::npos) {
+    searchStart = text.size();
+    if (!decodeText()) {
+      if (text.empty()) {
+        return false;
+      }
+      lineEnd = text.size(); // last line without '\n'
+      break;
+    }
+  }
+
+  line = text.substr(0, lineEnd);
+  size_t lineSize = std::min(lineEnd + 1, text.size());
+  text.remove_prefix(lineSize);
+  byteCount += lineSize;
+  return true;
+}
+
+string dpve::util::InputFile::getCompression() const {
+  return compression;
+}
+
+size_t dpve::util::InputFile::getByteCount() const {
+  return byteCount;
+}
+
+void dpve::util::InputFile::readRaw() {
+  rawBuffer.erase(0, rawBuffer.size() - raw.size());
+  size_t oldSize = rawBuffer.size();
+  rawBuffer.resize(oldSize + CHUNK_SIZE);
+
+  ssize_t count;
+  do {
+    count = read(fileDescriptor, rawBuffer.data() + oldSize, CHUNK_SIZE);
+  } while (count < 0 && errno == EINTR);
+  if (count < 0) {
+    throw MyError("unable to read file '", filePath, "'");
+  }
+
+  rawBuffer.resize(oldSize + count);
+  raw = rawBuffer;
+  rawEnded = count == 0;
+}
+
+bool dpve::util::InputFile::decodeText() {
+  if (decoder == nullptr) { // whole mapping is already `text`
+    return false;
+  }
+
+  buffer.erase(0, buffer.size() - text.size());
+  while (true) {
+    if (raw.empty() && !rawEnded) {
+      readRaw();
+    }
+
+    size_t oldSize = buffer.size();
+    buffer.resize(oldSize + CHUNK_SIZE);
+    size_t count = decoder->decode(raw, rawEnded, buffer.data() + oldSize, CHUNK_SIZE);
+    buffer.resize(oldSize + count);
+    text = buffer;
+
+    if (count > 0) {
+      return true;
+    }
+    if (raw.empty() && rawEnded) {
+      if (!decoder->isComplete()) {
+        throw MyError("truncated ", compression, " file '", filePath, "'");
+      }
+      return false;
+    }
+  }
+}
+
 /* classes for exceptions =================================================== */
 
 /* class EmptyClauseException =============================================== */
@@ -43,3 +439,180 @@ dpve::util::EmptyClauseException::EmptyClauseException(Int lineIndex, const stri
 dpve::util::UnsatSolverException::UnsatSolverException() {
   cout << dpve::io::WARNING << "unsatisfiable CNF, according to SAT solver\n";
 }
+
+/* class Trace ============================================================== */
+
+namespace {
+  std::ofstream traceFile;
+  TimePoint traceStartPoint;
+  std::mutex traceMutex; // GC hooks of Sylvan run on worker threads, and sampler thread of Monitor may close trace
+  std::atomic<bool> traceOpen = false; // read without lock, so that closed trace costs no locking
+  bool traceHasEvent = false;
+
+  Int getThreadIndex() { // small and stable, unlike std::thread::id
+    static std::atomic<Int> threadCount = 0;
+    thread_local Int threadIndex = threadCount++;
+    return threadIndex;
+  }
+
+  Int getMicroseconds(TimePoint timePoint) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(timePoint - traceStartPoint).count();
+  }
+
+  void writeEvent(const string& name, const string& phase, TimePoint startPoint, const string& fields) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (!traceOpen) { // closed since caller checked
+      return;
+    }
+    traceFile << (traceHasEvent ? ",\n" : "") << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"ts\":" << getMicroseconds(startPoint) <<
+      ",\"pid\":" << getpid() << ",\"tid\":" << getThreadIndex() << fields << "}";
+    traceHasEvent = true;
+  }
+}
+
+bool dpve::util::Trace::isOpen() {
+  return traceOpen;
+}
+
+void dpve::util::Trace::open(const string& filePath) {
+  traceFile.open(filePath);
+  if (!traceFile) {
+    throw MyError("unable to write trace file ", filePath);
+  }
+  traceStartPoint = getTimePoint();
+  traceFile << "[\n";
+  traceOpen = true;
+}
+
+void dpve::util::Trace::close() {
+  std::lock_guard<std::mutex> lock(traceMutex);
+  if (traceOpen) {
+    traceOpen = false;
+    traceFile << "\n]\n";
+    traceFile.close();
+  }
+}
+
+void dpve::util::Trace::addSpan(const string& name, TimePoint startPoint, TimePoint endPoint, const Args& args) {
+  if (!isOpen()) {
+    return;
+  }
+  string fields = ",\"dur\":" + std::to_string(getMicroseconds(endPoint) - getMicroseconds(startPoint));
+  if (!args.empty()) {
+    fields += ",\"args\":{";
+    for (size_t i = 0; i < args.size(); i++) {
+      fields += (i > 0 ? ",\"" : "\"") + args[i].first + "\":" + args[i].second;
+    }
+    fields += "}";
+  }
+  writeEvent(name, "X", startPoint, fields);
+}
+
+void dpve::util::Trace::beginSpan(const string& name) {
+  if (isOpen()) {
+    writeEvent(name, "B", getTimePoint(), "");
+  }
+}
+
+void dpve::util::Trace::endSpan(const string& name) {
+  if (isOpen()) {
+    writeEvent(name, "E", getTimePoint(), "");
+  }
+}
+
+/* class PerfCounters ======================================================= */
+
+const vector<string> dpve::util::PerfCounters::EVENT_NAMES = {"cycles", "instructions", "llcMisses", "dtlbMisses"};
+int dpve::util::PerfCounters::groupFd = -1;
+std::map<string, pair<Int, dpve::util::PerfCounters::Counts>> dpve::util::PerfCounters::totals;
+std::mutex dpve::util::PerfCounters::totalsMutex;
+
+bool dpve::util::PerfCounters::isOpen() {
+  return groupFd >= 0;
+}
+
+bool dpve::util::PerfCounters::open() {
+  const vector<pair<uint32_t, uint64_t>> events = { // same order as EVENT_NAMES
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}, // last-level cache
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+  };
+  for (const auto& [type, config] : events) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0; // group leader starts the group
+    attr.exclude_kernel = 1; // allowed with perf_event_paranoid = 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP; // one read for all counters
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0); // calling thread, any CPU
+    if (fd < 0) {
+      cout << "c o WARNING: hardware counters unavailable: " << strerror(errno) << "\n";
+      close();
+      return false;
+    }
+    if (groupFd < 0) {
+      groupFd = fd;
+    }
+  }
+  ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+}
+
+void dpve::util::PerfCounters::close() {
+  if (isOpen()) {
+    ::close(groupFd); // members are freed with leader
+    groupFd = -1;
+  }
+}
+
+dpve::util::PerfCounters::Counts dpve::util::PerfCounters::read() {
+  Counts counts{};
+  uint64_t values[1 + std::tuple_size_v<Counts>]; // counter count, then counts
+  if (isOpen() && ::read(groupFd, values, sizeof(values)) == sizeof(values)) {
+    std::copy(values + 1, values + 1 + counts.size(), counts.begin());
+  }
+  return counts;
+}
+
+void dpve::util::PerfCounters::add(const string& category, const Counts& startCounts) {
+  Counts counts = read();
+  std::lock_guard<std::mutex> lock(totalsMutex);
+  auto& [callCount, total] = totals[category];
+  callCount++;
+  for (size_t i = 0; i < counts.size(); i++) {
+    total[i] += counts[i] - startCounts[i];
+  }
+}
+
+void dpve::util::PerfCounters::printRows() {
+  std::lock_guard<std::mutex> lock(totalsMutex);
+  for (const auto& [category, callCountAndTotal] : totals) {
+    const auto& [callCount, total] = callCountAndTotal;
+    std::ostringstream row;
+    row << "calls=" << callCount;
+    for (size_t i = 0; i < total.size(); i++) {
+      row << " " << EVENT_NAMES[i] << "=" << total[i];
+      io::Report::add("counters", category + "." + EVENT_NAMES[i], total[i]);
+    }
+    row << " ipc=" << std::fixed << std::setprecision(2) << (total[0] > 0 ? (double) total[1] / total[0] : 0.0);
+    io::Report::add("counters", category + ".calls", callCount);
+    io::printRow("counters " + category, row.str());
+  }
+}
+
+dpve::util::PerfScope::PerfScope(const char* category) {
+  if (PerfCounters::isOpen()) {
+    this->category = category;
+    startCounts = PerfCounters::read();
+  }
+}
+
+dpve::util::PerfScope::~PerfScope() {
+  if (category != nullptr) {
+    PerfCounters::add(category, startCounts);
+  }
+}
@@ -2,10 +2,14 @@
 
 #include "types.hpp"
 
+#include <array>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <string_view>
 
 /* namespaces =============================================================== */
 using std::cout;
@@ -26,6 +30,12 @@ namespace dpve::util {
     UnsatSolverException();
   };
 
+  class AbortException : public std::exception { // early exit with partial results, e.g. by memory governor
+  public:
+    const string reason;
+    AbortException(const string& reason): reason(reason) {}
+  };
+
   class MyError : public std::exception {
   public:
     template<typename ... Ts> MyError(const Ts& ... args) { // en.cppreference.com/w/cpp/language/fold
@@ -44,7 +54,90 @@ namespace dpve::util {
   Float getDuration(TimePoint start); // in seconds
 
   vector<string> splitInputLine(const string& line);
-  
+  std::string_view getNextWord(std::string_view& text); // removes leading whitespace and word from `text`
+  Int parseInt(std::string_view word); // decimal; faster than stoll for literals
+  void appendVarint(string& bytes, Int num); // unsigned LEB128 for nonnegative num, as in binary join trees
+  Int readVarint(std::string_view& bytes); // removes varint from front of `bytes`
+
+  const uint64_t HASH_SEED = 14695981039346656037ull; // FNV-1a offset basis
+  void mixHash(uint64_t& hash, Int word); // FNV-1a over bytes of `word`, so that hashes are stable across runs and machines
+  void mixHash(uint64_t& hash, std::string_view bytes);
+  string getHexString(uint64_t hash); // 16 digits, for file names
+
+  class Decoder; // of compressed data, in util.cpp
+
+  class InputFile { // lines of file, memory-mapped if regular; decoded in chunks if compressed (gzip, xz, or zstd if built with ZSTD) or read in chunks if not regular (e.g. pipe)
+  public:
+    InputFile(const string& filePath);
+    ~InputFile();
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+    bool getLine(std::string_view& line); // without '\n' and valid until next call; false at end of file
+    string getCompression() const; // "none", "gzip", "xz", or "zstd"
+    size_t getByteCount() const; // of decoded lines so far
+
+  private:
+    string filePath;
+    int fileDescriptor = -1;
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+
+    string compression = "none";
+    std::unique_ptr<Decoder> decoder; // null iff lines are read directly from mapping
+    string rawBuffer; // chunk read from file if not mapped
+    std::string_view raw; // undecoded rest of mapping or `rawBuffer`
+    bool rawEnded = false;
+    string buffer; // decoded bytes, ending with `text`
+
+    std::string_view text; // not yet returned as lines
+    size_t byteCount = 0;
+
+    void readRaw(); // refills `raw` from file
+    bool decodeText(); // appends to `text`; false at end of file
+  };
+
+  class Trace { // events in Chrome trace-event format (JSON array), for Perfetto or chrome://tracing; off unless opened
+  public:
+    using Args = vector<pair<string, string>>; // name, JSON value
+
+    static bool isOpen();
+    static void open(const string& filePath); // timestamps are relative to this
+    static void close(); // ends JSON array (readers also accept a trace cut off by a killed run)
+
+    static void addSpan(const string& name, TimePoint startPoint, TimePoint endPoint, const Args& args = Args()); // complete event, on calling thread
+    static void beginSpan(const string& name); // for hooks that see start and end separately, on same thread
+    static void endSpan(const string& name);
+  };
+
+  class PerfCounters { // Linux hardware counters (perf_event_open) of main thread, summed by category; off unless opened
+  public:
+    static const vector<string> EVENT_NAMES; // cycles, instructions, LLC misses, dTLB misses
+    using Counts = std::array<uint64_t, 4>;
+
+    static bool isOpen();
+    static bool open(); // false with warning if counters are unavailable, e.g. in containers or with high perf_event_paranoid
+    static void close();
+    static Counts read(); // since open
+    static void add(const string& category, const Counts& startCounts); // counts since `startCounts`
+    static void printRows(); // one row per category, also reported
+
+  private:
+    static int groupFd;
+    static std::map<string, pair<Int, Counts>> totals; // category |-> (call count, counts)
+    static std::mutex totalsMutex; // rows are also printed by sampler thread of Monitor before it exits
+  };
+
+  class PerfScope { // adds counts of its lifetime to a category, inclusive of nested scopes; does nothing unless counters are open
+  public:
+    PerfScope(const char* category);
+    ~PerfScope();
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+  private:
+    const char* category = nullptr; // null if counters are closed
+    PerfCounters::Counts startCounts;
+  };
 
   template<typename T, typename U> pair<U, T> flipPair(const pair<T, U>& p) {
     return pair<U, T>(p.second, p.first);
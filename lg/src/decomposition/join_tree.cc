@@ -10,6 +10,7 @@ Copyright (c) 2020, Jeffrey Dudek
 #include <numeric>
 #include <unordered_set>
 #include <set>
+#include <string>
 #include <vector>
 
 namespace decomposition {
@@ -182,7 +183,20 @@ void JoinTree::compute_projected_variables(const util::Formula &formula) {
   }
 }
 
-void JoinTree::write(std::ostream *output) const {
+namespace {
+  /**
+   * Appends value to bytes as an unsigned LEB128 varint.
+   */
+  void appendVarint(size_t value, std::string *bytes) {
+    while (value >= 0x80) {
+      bytes->push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    bytes->push_back(static_cast<char>(value));
+  }
+}  // namespace
+
+void JoinTree::write(std::ostream *output, bool binary) const {
   // The .jt format uses dummy nodes if clauses have projected variables.
   // Compute the total number of nodes in the tree including these dummy nodes.
   size_t num_nodes = visit<size_t>([&](const JoinTreeNode &node,
@@ -204,12 +218,15 @@ void JoinTree::write(std::ostream *output) const {
     return result;
   });
 
-  // Write the join tree header
-  *output << "p jt";
-  *output << " " << highest_projected_var_;
-  *output << " " << highest_leaf_id_+1;
-  *output << " " << num_nodes;
-  *output << "\n";
+  // Write the join tree header, unless binary (which needs the byte count)
+  if (!binary) {
+    *output << "p jt";
+    *output << " " << highest_projected_var_;
+    *output << " " << highest_leaf_id_+1;
+    *output << " " << num_nodes;
+    *output << "\n";
+  }
+  std::string bytes;
 
   // Print out all internal nodes
   size_t next_id = highest_leaf_id_+2;
@@ -228,19 +245,42 @@ void JoinTree::write(std::ostream *output) const {
       children.push_back(node.clause_id+1);
     }  // Fall-through
 
-    *output << next_id;
-    for (size_t child : children) {
-      *output << " " << child;
-    }
-    *output << " e";
-    for (size_t projected : node.projected_variables) {
-      *output << " " << projected;
+    if (binary) {
+      appendVarint(next_id, &bytes);
+      appendVarint(children.size(), &bytes);
+      for (size_t child : children) {
+        appendVarint(child, &bytes);
+      }
+      appendVarint(node.projected_variables.size(), &bytes);
+      for (size_t projected : node.projected_variables) {
+        appendVarint(projected, &bytes);
+      }
+    } else {
+      *output << next_id;
+      for (size_t child : children) {
+        *output << " " << child;
+      }
+      *output << " e";
+      for (size_t projected : node.projected_variables) {
+        *output << " " << projected;
+      }
+      *output << "\n";
     }
-    *output << "\n";
     next_id++;
     return next_id-1;
   });
 
+  if (binary) {
+    *output << "p bjt";
+    *output << " " << highest_projected_var_;
+    *output << " " << highest_leaf_id_+1;
+    *output << " " << num_nodes;
+    *output << " " << bytes.size();
+    *output << "\n";
+    output->write(bytes.data(), bytes.size());
+    *output << "\n";
+  }
+
   // Print out the join tree width
   *output << "c joinTreeWidth " << width_ << "\n";
 }
@@ -17,19 +17,33 @@ int main(int argc, char *argv[]) {
   // Print help message
   if (argc == 2 &&
       (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)) {
-      std::cout << argv[0] << " [TREE DECOMPOSER] [H]" << std::endl;
+      std::cout << argv[0] << " [TREE DECOMPOSER] [H] [B]" << std::endl;
       std::cout << "    Use [TREE DECOMPOSER] to make join trees." << std::endl;
-      std::cout << "    H: if second parameter is present and 'H', then use hypertree decompositions" << std::endl;
+      std::cout << "    H: if a later parameter is 'H', then use hypertree decompositions" << std::endl;
+      std::cout << "    B: if a later parameter is 'B', then write join trees in binary (read by DMC)" << std::endl;
       std::cout << "    Input formula is parsed from STDIN." << std::endl;
       std::cout << "    Join trees are written to STDOUT." << std::endl;
       return 0;
   }
 
-  if (argc > 3) {
-    std::cerr << "Error: At most 2 arguments required." << std::endl;
+  if (argc > 4) {
+    std::cerr << "Error: At most 3 arguments required." << std::endl;
     return -1;
   }
 
+  bool hypertree = false;
+  bool binary = false;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "H") == 0) {
+      hypertree = true;
+    } else if (strcmp(argv[i], "B") == 0) {
+      binary = true;
+    } else {
+      std::cerr << "Error: Unknown argument " << argv[i] << std::endl;
+      return -1;
+    }
+  }
+
   try {
     // Start the tree decomposition solver.
     boost::process::opstream solver_input;
@@ -52,7 +66,7 @@ int main(int argc, char *argv[]) {
 
     // Provide the line graph of the input formula to the solver.
     util::GradedClauses clauses = f->graded_clauses();
-    if ((argc == 3) && (strcmp(argv[2], "H") == 0)) {
+    if (hypertree) {
       std::cout << "c Writing hypergraph.. " << std::endl;
       clauses.write_hyper_line_graph(&solver_input, f->num_variables());
     } else {
@@ -82,7 +96,7 @@ int main(int argc, char *argv[]) {
       }
 
       // Output the join tree to stdout.
-      jt->write(&std::cout);
+      jt->write(&std::cout, binary);
 
       auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
         std::chrono::steady_clock::now() - start_time).count();
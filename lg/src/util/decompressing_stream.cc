@@ -0,0 +1,266 @@
+/******************************************
+Copyright (c) 2020, Jeffrey Dudek
+******************************************/
+
+#include "util/decompressing_stream.h"
+
+#include <lzma.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#ifdef ZSTD
+#include <zstd.h>
+#endif
+
+namespace util {
+  /**
+   * Decodes the bytes of one compression format.
+   */
+  class DecompressingStreamBuf::Decoder {
+   public:
+    virtual ~Decoder() = default;
+
+    /**
+     * Consumes a prefix of the given raw bytes and writes at most out_size
+     * decoded bytes to out. Returns the number of decoded bytes.
+     *
+     * Throws std::runtime_error if the raw bytes are corrupt.
+     */
+    virtual size_t decode(std::string_view *raw, bool raw_ended, char *out,
+                          size_t out_size) = 0;
+
+    /**
+     * Returns true if the decoded bytes so far end at a stream boundary.
+     */
+    virtual bool complete() const = 0;
+  };
+}  // namespace util
+
+namespace {
+  const size_t kChunkSize = 1 << 16;
+
+  const std::string_view kGzipMagic("\x1f\x8b", 2);
+  const std::string_view kXzMagic("\xfd" "7zXZ\0", 6);
+  const std::string_view kZstdMagic("\x28\xb5\x2f\xfd", 4);
+  const size_t kMagicSize = 6;  // longest
+
+  bool hasPrefix(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+  }
+
+  class PlainDecoder : public util::DecompressingStreamBuf::Decoder {
+   public:
+    size_t decode(std::string_view *raw, bool raw_ended, char *out,
+                  size_t out_size) override {
+      size_t count = std::min(raw->size(), out_size);
+      std::memcpy(out, raw->data(), count);
+      raw->remove_prefix(count);
+      return count;
+    }
+
+    bool complete() const override { return true; }
+  };
+
+  // Concatenated members are decoded like gzip -d.
+  class GzipDecoder : public util::DecompressingStreamBuf::Decoder {
+   public:
+    GzipDecoder() {
+      if (inflateInit2(&stream_, 15 + 16) != Z_OK) {  // 16: gzip header
+        throw std::runtime_error("unable to initialize gzip decoder");
+      }
+    }
+
+    ~GzipDecoder() override { inflateEnd(&stream_); }
+
+    size_t decode(std::string_view *raw, bool raw_ended, char *out,
+                  size_t out_size) override {
+      if (member_ended_ && !raw->empty()) {
+        inflateReset(&stream_);
+        member_ended_ = false;
+      }
+      stream_.next_in = reinterpret_cast<Bytef *>(
+        const_cast<char *>(raw->data()));
+      stream_.avail_in = raw->size();
+      stream_.next_out = reinterpret_cast<Bytef *>(out);
+      stream_.avail_out = out_size;
+
+      int status = inflate(&stream_, Z_NO_FLUSH);
+      if (status == Z_STREAM_END) {
+        member_ended_ = true;
+      } else if (status != Z_OK && status != Z_BUF_ERROR) {
+        throw std::runtime_error(std::string("corrupt gzip data: ")
+                                 + (stream_.msg ? stream_.msg : "unknown"));
+      }
+
+      raw->remove_prefix(raw->size() - stream_.avail_in);
+      return out_size - stream_.avail_out;
+    }
+
+    bool complete() const override { return member_ended_; }
+
+   private:
+    z_stream stream_{};
+    bool member_ended_ = false;
+  };
+
+  class XzDecoder : public util::DecompressingStreamBuf::Decoder {
+   public:
+    XzDecoder() {
+      if (lzma_stream_decoder(&stream_, UINT64_MAX, LZMA_CONCATENATED)
+          != LZMA_OK) {
+        throw std::runtime_error("unable to initialize xz decoder");
+      }
+    }
+
+    ~XzDecoder() override { lzma_end(&stream_); }
+
+    size_t decode(std::string_view *raw, bool raw_ended, char *out,
+                  size_t out_size) override {
+      stream_.next_in = reinterpret_cast<const uint8_t *>(raw->data());
+      stream_.avail_in = raw->size();
+      stream_.next_out = reinterpret_cast<uint8_t *>(out);
+      stream_.avail_out = out_size;
+
+      // LZMA_CONCATENATED only reports the end of input after LZMA_FINISH
+      lzma_ret status = lzma_code(&stream_,
+                                  raw_ended ? LZMA_FINISH : LZMA_RUN);
+      if (status == LZMA_STREAM_END) {
+        stream_ended_ = true;
+      } else if (status != LZMA_OK && status != LZMA_BUF_ERROR) {
+        throw std::runtime_error("corrupt xz data: lzma_ret "
+                                 + std::to_string(status));
+      }
+
+      raw->remove_prefix(raw->size() - stream_.avail_in);
+      return out_size - stream_.avail_out;
+    }
+
+    bool complete() const override { return stream_ended_; }
+
+   private:
+    lzma_stream stream_ = LZMA_STREAM_INIT;
+    bool stream_ended_ = false;
+  };
+
+#ifdef ZSTD
+  // Concatenated frames are decoded like zstd -d.
+  class ZstdDecoder : public util::DecompressingStreamBuf::Decoder {
+   public:
+    ZstdDecoder() : stream_(ZSTD_createDStream()) {
+      if (stream_ == nullptr || ZSTD_isError(ZSTD_initDStream(stream_))) {
+        throw std::runtime_error("unable to initialize zstd decoder");
+      }
+    }
+
+    ~ZstdDecoder() override { ZSTD_freeDStream(stream_); }
+
+    size_t decode(std::string_view *raw, bool raw_ended, char *out,
+                  size_t out_size) override {
+      ZSTD_inBuffer input{raw->data(), raw->size(), 0};
+      ZSTD_outBuffer output{out, out_size, 0};
+
+      size_t status = ZSTD_decompressStream(stream_, &output, &input);
+      if (ZSTD_isError(status)) {
+        throw std::runtime_error(std::string("corrupt zstd data: ")
+                                 + ZSTD_getErrorName(status));
+      }
+      if (input.pos > 0 || output.pos > 0) {
+        frame_ended_ = status == 0;  // frame fully decoded and flushed
+      }
+
+      raw->remove_prefix(input.pos);
+      return output.pos;
+    }
+
+    bool complete() const override { return frame_ended_; }
+
+   private:
+    ZSTD_DStream *stream_;
+    bool frame_ended_ = false;
+  };
+#endif
+}  // namespace
+
+namespace util {
+  DecompressingStreamBuf::DecompressingStreamBuf(std::istream *stream)
+  : input_stream_(stream), decoded_(kChunkSize) {
+    while (raw_.size() < kMagicSize && !raw_ended_) {
+      readRaw();
+    }
+
+    std::string_view head(raw_.data(), raw_.size());
+    try {
+      if (hasPrefix(head, kGzipMagic)) {
+        compression_ = "gzip";
+        decoder_ = std::make_unique<GzipDecoder>();
+      } else if (hasPrefix(head, kXzMagic)) {
+        compression_ = "xz";
+        decoder_ = std::make_unique<XzDecoder>();
+      } else if (hasPrefix(head, kZstdMagic)) {
+#ifdef ZSTD
+        compression_ = "zstd";
+        decoder_ = std::make_unique<ZstdDecoder>();
+#else
+        throw std::runtime_error("zstd input requires building with ZSTD=1");
+#endif
+      } else {
+        decoder_ = std::make_unique<PlainDecoder>();
+      }
+    } catch (const std::runtime_error &error) {
+      std::cerr << "Decode error: " << error.what() << std::endl;
+      ok_ = false;
+    }
+    setg(decoded_.data(), decoded_.data(), decoded_.data());
+  }
+
+  DecompressingStreamBuf::~DecompressingStreamBuf() = default;
+
+  DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (!ok_) return traits_type::eof();
+
+    try {
+      while (true) {
+        if (raw_begin_ == raw_.size() && !raw_ended_) {
+          readRaw();
+        }
+
+        std::string_view raw(raw_.data() + raw_begin_,
+                             raw_.size() - raw_begin_);
+        size_t count = decoder_->decode(&raw, raw_ended_, decoded_.data(),
+                                        decoded_.size());
+        raw_begin_ = raw_.size() - raw.size();
+
+        if (count > 0) {
+          setg(decoded_.data(), decoded_.data(), decoded_.data() + count);
+          return traits_type::to_int_type(*gptr());
+        }
+        if (raw.empty() && raw_ended_) {
+          if (!decoder_->complete()) {
+            throw std::runtime_error("truncated " + compression_ + " input");
+          }
+          return traits_type::eof();
+        }
+      }
+    } catch (const std::runtime_error &error) {
+      std::cerr << "Decode error: " << error.what() << std::endl;
+      ok_ = false;
+      return traits_type::eof();
+    }
+  }
+
+  void DecompressingStreamBuf::readRaw() {
+    raw_.erase(raw_.begin(), raw_.begin() + raw_begin_);
+    raw_begin_ = 0;
+
+    size_t old_size = raw_.size();
+    raw_.resize(old_size + kChunkSize);
+    input_stream_->read(raw_.data() + old_size, kChunkSize);
+    size_t count = input_stream_->gcount();
+    raw_.resize(old_size + count);
+    raw_ended_ = count == 0;
+  }
+}  // namespace util
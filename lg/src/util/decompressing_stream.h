@@ -0,0 +1,67 @@
+/******************************************
+Copyright (c) 2020, Jeffrey Dudek
+******************************************/
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace util {
+/**
+ * A stream buffer that decodes a possibly compressed input stream.
+ *
+ * The compression (gzip, xz, or zstd if built with ZSTD) is detected from
+ * the magic bytes at the start of the input. Uncompressed input is passed
+ * through unchanged. Decoding happens chunk by chunk as the buffer is read,
+ * so no decompressed copy of the input is ever stored.
+ */
+class DecompressingStreamBuf : public std::streambuf {
+ public:
+  /**
+   * Constructs a buffer to decode the provided input stream, which should
+   * outlive the DecompressingStreamBuf.
+   */
+  explicit DecompressingStreamBuf(std::istream *stream);
+  ~DecompressingStreamBuf() override;
+
+  /**
+   * Returns "none", "gzip", "xz", or "zstd".
+   */
+  const std::string &compression() const { return compression_; }
+
+  /**
+   * Returns false if the compressed input was corrupt or truncated. The
+   * buffer ends early in this case, and the error is written to stderr.
+   */
+  bool ok() const { return ok_; }
+
+  class Decoder;
+
+ protected:
+  int_type underflow() override;
+
+ private:
+  /**
+   * Reads the next chunk of the input stream into raw_.
+   */
+  void readRaw();
+
+  // The underlying input stream being decoded.
+  std::istream *input_stream_;
+  std::string compression_ = "none";
+  std::unique_ptr<Decoder> decoder_;
+  bool ok_ = true;
+
+  // Undecoded bytes of the input stream, from raw_begin_ to raw_.size().
+  std::vector<char> raw_;
+  size_t raw_begin_ = 0;
+  bool raw_ended_ = false;
+
+  // Decoded bytes, exposed as the get area.
+  std::vector<char> decoded_;
+};
+}  // namespace util
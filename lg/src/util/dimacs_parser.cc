@@ -5,11 +5,31 @@ Copyright (c) 2020, Jeffrey Dudek
 #include "util/dimacs_parser.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <iterator>
 #include <limits>
-#include <sstream>
 #include <utility>
 
+namespace {
+  /**
+   * Adds each double of the line (beyond the given position) to out, stopping
+   * at the first word that is not a double.
+   *
+   * Parses in place with strtod rather than through a stringstream.
+   */
+  void parseDoubles(const std::string &line, std::size_t position,
+                    std::vector<double> *out) {
+    const char *start = line.c_str() + position;
+    char *end;
+    while (true) {
+      double value = std::strtod(start, &end);
+      if (end == start) break;
+      out->push_back(value);
+      start = end;
+    }
+  }
+}  // namespace
+
 namespace util {
   DimacsParser::DimacsParser(std::istream *stream)
   : input_stream_(stream), comment_stream_(nullptr)
@@ -30,11 +50,7 @@ namespace util {
       split = line.size();
     } else {
       // Copy all doubles from the line (beyond the prefix) into out
-      std::stringstream line_stream(line);
-      line_stream.seekg(static_cast<std::streamoff>(split));
-      std::copy(std::istream_iterator<double>(line_stream),
-                std::istream_iterator<double>(),
-                std::back_inserter(*out));
+      parseDoubles(line, split, out);
     }
 
 
@@ -65,10 +81,7 @@ namespace util {
     // Copy all remaining doubles from the line into out
     std::string line;
     std::getline(*input_stream_, line);
-    std::stringstream line_stream(line);
-    std::copy(std::istream_iterator<double>(line_stream),
-              std::istream_iterator<double>(),
-              std::back_inserter(*out));
+    parseDoubles(line, 0, out);
     return true;
   }
 
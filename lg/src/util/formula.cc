@@ -7,6 +7,7 @@ Copyright (c) 2020, Jeffrey Dudek
 #include <algorithm>
 #include <string_view>
 
+#include "util/decompressing_stream.h"
 #include "util/dimacs_parser.h"
 
 namespace util {
@@ -32,7 +33,10 @@ namespace util {
   }
 
   std::optional<Formula> Formula::parse_DIMACS(std::istream *stream) {
-    util::DimacsParser parser(stream);
+    // Decode compressed input while parsing, without a temporary file
+    util::DecompressingStreamBuf decompressing_buffer(stream);
+    std::istream decompressing_stream(&decompressing_buffer);
+    util::DimacsParser parser(&decompressing_stream);
 
     // Parse the header
     std::vector<double> entries;
@@ -96,6 +100,12 @@ namespace util {
       }
     }
 
+    if (!decompressing_buffer.ok()) {
+      std::cerr << "Parse error: Unable to decode "
+                << decompressing_buffer.compression() << " input" << std::endl;
+      return std::nullopt;
+    }
+
     // Verify that we have parsed the correct number of clauses
     if (num_clauses_to_parse != 0) {
       std::cout << "c Parse warning: Expected " << num_clauses_to_parse;
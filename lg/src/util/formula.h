@@ -43,7 +43,8 @@ class Formula {
   }
 
   /*
-  * Parses a file in DIMACS format into a boolean formula.
+  * Parses a file in DIMACS format into a boolean formula. The file may be
+  * compressed with gzip, xz, or zstd (if built with ZSTD).
   *
   * Returns the parsed formula if the DIMACS file is in a valid format.
   */
@@ -2,8 +2,11 @@
 
 import argparse
 import functools
+import gzip
+import lzma
 import math
 import os
+import shutil
 import subprocess
 import time
 
@@ -17,6 +20,9 @@ PWMC = 'pwmc'
 UI = 'ui'
 TU = 'tu'
 
+GZIP_MAGIC = b'\x1f\x8b'
+XZ_MAGIC = b'\xfd7zXZ\x00'
+
 toolIndex = 0
 
 def cat(cmd):
@@ -31,6 +37,19 @@ def printCallLine(cmd):
 def getBinPath(*paths):
     return os.path.join(os.path.dirname(os.path.realpath(__file__)), *paths)
 
+def isCompressed(cnf): # dmc and lg decode compressed CNF files themselves
+    with open(cnf, 'rb') as inFile:
+        return inFile.read(len(XZ_MAGIC)).startswith((GZIP_MAGIC, XZ_MAGIC))
+
+def openCnf(cnf, mode='rt'): # decodes gzip and xz while reading
+    with open(cnf, 'rb') as inFile:
+        magic = inFile.read(len(XZ_MAGIC))
+    if magic.startswith(GZIP_MAGIC):
+        return gzip.open(cnf, mode)
+    if magic.startswith(XZ_MAGIC):
+        return lzma.open(cnf, mode)
+    return open(cnf, mode)
+
 def addArgs(argParser):
     argParser.add_argument(
         'cnf',
@@ -44,8 +63,8 @@ def addArgs(argParser):
     )
     argParser.add_argument(
         '--pre',
-        choices=(0, 1),
-        help='whether to call preprocessor pmc',
+        choices=(0, 1, 2),
+        help='preprocessing: 0 none, 1 pmc, 2 in dmc with its in-process planner',
         default=1,
         type=int,
     )
@@ -108,9 +127,10 @@ def preprocessCnf(megs, cnf, outDirPath, task, mp, vs):
     def printTime():
         print(f'c preprocessor seconds: {time.time() - startTime}\n')
 
+    compressed = isCompressed(cnf)
     cmd = [
         getBinPath('pmc'),
-        cnf,
+        '/dev/stdin' if compressed else cnf, # decoded CNF is piped, without a temp file
         # f'-mem-lim={megs}', # segfault if megs in range(8192, 8199)
         # '-verb=2', # would print line '|  Garbage collection:' (default: 1)
         # '-solve', # with SAT solving (default: -no-solve)
@@ -130,8 +150,8 @@ def preprocessCnf(megs, cnf, outDirPath, task, mp, vs):
             '-affine',
         ]
     else: # WMC, PMC, PWMC
-        with open(cnf) as inFile:
-            for line in open(cnf):
+        with openCnf(cnf) as inFile:
+            for line in inFile:
                 if line.startswith('c p'):
                     cpLines.append(line)
 
@@ -143,10 +163,21 @@ def preprocessCnf(megs, cnf, outDirPath, task, mp, vs):
 
     printCallLine(cmd)
 
-    subprocess.run(
-        cat(cmd),
-        shell=True,
-    )
+    if compressed:
+        pmcProcess = subprocess.Popen(
+            cat(cmd),
+            shell=True,
+            stdin=subprocess.PIPE,
+        )
+        with openCnf(cnf, 'rb') as inFile:
+            shutil.copyfileobj(inFile, pmcProcess.stdin)
+        pmcProcess.stdin.close()
+        pmcProcess.wait()
+    else:
+        subprocess.run(
+            cat(cmd),
+            shell=True,
+        )
 
     with open(outFilePath) as outFile: # preprocessor may have solved benchmark
         count = None
@@ -179,6 +210,7 @@ def planJt(cnfPath, width, task, vs):
     cmd = [
         getBinPath('lg'),
         f'"{lgArg}"',
+        'B', # binary join trees, which dmc reads faster
         f'<{cnfPath}',
     ]
 
@@ -219,13 +251,14 @@ def main():
     megs = int(megs)
     print()
 
-    if args.pre:
+    if args.pre == 1:
         os.makedirs(outDirPath, exist_ok=True)
         cnfPath = preprocessCnf(megs, args.cnf, outDirPath, args.task, args.mp, args.vs)
     else:
         cnfPath = args.cnf
 
-    plannerProcess = planJt(cnfPath, args.width, args.task, args.vs)
+    builtinPre = args.pre == 2 # join tree of external planner would refer to unpreprocessed clauses
+    plannerProcess = None if builtinPre else planJt(cnfPath, args.width, args.task, args.vs)
 
     dmcCmd = [
         getBinPath('dmc'),
@@ -240,14 +273,21 @@ def main():
         f'--vj={args.vs}',
         f'--vs={args.vs}',
     ]
+    if builtinPre:
+        dmcCmd += [
+            '--pp=1',
+            '--ch=bmt',
+        ]
     dmcProcess = subprocess.Popen(
         dmcCmd,
-        stdin=plannerProcess.stdout,
+        stdin=subprocess.DEVNULL if builtinPre else plannerProcess.stdout,
     )
 
-    plannerProcess.stdout.close() # allows plannerProcess to receive SIGPIPE if dmcProcess exits
-
-    printCallLine(['|'] + dmcCmd)
+    if builtinPre:
+        printCallLine(dmcCmd)
+    else:
+        plannerProcess.stdout.close() # allows plannerProcess to receive SIGPIPE if dmcProcess exits
+        printCallLine(['|'] + dmcCmd)
     print()
 
     dmcProcess.communicate()
@@ -0,0 +1,166 @@
+import argparse
+import glob
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# benchmark and regression suite for DMC over the bundled formulas, using the JSON run report (--rf)
+# usage: python3 dmcBench.py <dmc binary> [--repeats 3] [--save results.json] [--baseline results.json] [--threshold 0.2]
+# runs every formula under a matrix of configs, each varying one axis from the base config, then a thread-scaling series with Sylvan
+# prints one row per (formula, config): mean and standard deviation of seconds, peak RSS, peak unique-table nodes, log10 count
+# exits with 1 if a config fails, disagrees with the base count, or regresses past the threshold versus the baseline
+
+repoDir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+defaultFormulas = sorted(glob.glob(os.path.join(repoDir, 'tests', '*', '*.cnf')) + glob.glob(os.path.join(repoDir, 'examples', '*.cnf')))
+
+baseConfig = {'dp': 'c', 'tc': '1', 'jp': 's', 'dv': '4', 'ch': 'bmt'} # in-process planner, so that no planner process is needed
+axes = [ # one config per value, other options as in baseConfig
+	('dp', ['s']),
+	('lc', ['1']),
+	('mp', ['1']), # with Sylvan, below
+	('jp', ['a', 'b']),
+	('dv', ['3', '5', '-4']),
+]
+scalingThreadCounts = [n for n in [1, 2, 4, 8, 16] if n <= (os.cpu_count() or 1)]
+
+def getConfigs():
+	configs = [('base', dict(baseConfig))]
+	for flag, vals in axes:
+		for val in vals:
+			config = dict(baseConfig)
+			config[flag] = val
+			if flag == 'mp':
+				config['dp'] = 's' # multiple precision needs Sylvan
+			configs.append((flag+'='+val, config))
+	for threadCount in scalingThreadCounts:
+		config = dict(baseConfig)
+		config['dp'] = 's'
+		config['tc'] = str(threadCount)
+		configs.append(('scaling tc='+str(threadCount), config))
+	return configs
+
+def runDmc(dmc, formula, config, timeout):
+	with tempfile.NamedTemporaryFile(suffix='.json', delete=False) as reportFile:
+		reportPath = reportFile.name
+	args = [dmc, '--cf='+formula, '--rf='+reportPath] + ['--'+flag+'='+val for flag, val in config.items()]
+	start = time.time()
+	try:
+		completed = subprocess.run(args, stdin=subprocess.DEVNULL, capture_output=True, text=True, timeout=timeout)
+		failed = completed.returncode != 0
+	except subprocess.TimeoutExpired:
+		failed = True
+	wall = time.time() - start
+	report = None
+	if not failed:
+		try:
+			with open(reportPath) as f:
+				report = json.load(f)
+		except (OSError, ValueError):
+			pass
+	os.remove(reportPath)
+	if report is None:
+		return None
+	return {
+		'seconds': report.get('seconds', {}).get('total', wall),
+		'executionSeconds': report.get('seconds', {}).get('execution', 0),
+		'peakRssMegabytes': report.get('memory', {}).get('peakRssMegabytes', 0),
+		'peakTableNodes': report.get('diagrams', {}).get('peakTableNodes', 0),
+		'log10Estimate': report.get('solution', {}).get('log10Estimate'),
+	}
+
+def getStats(samples):
+	mean = sum(samples) / len(samples)
+	stdev = math.sqrt(sum((s - mean) ** 2 for s in samples) / (len(samples) - 1)) if len(samples) > 1 else 0.0
+	return mean, stdev
+
+def measure(dmc, formula, config, repeats, timeout):
+	runs = []
+	for i in range(repeats):
+		run = runDmc(dmc, formula, config, timeout)
+		if run is None:
+			return None
+		runs.append(run)
+	seconds = getStats([run['seconds'] for run in runs])
+	executionSeconds = getStats([run['executionSeconds'] for run in runs])
+	return {
+		'seconds': seconds[0], 'secondsStdev': seconds[1],
+		'executionSeconds': executionSeconds[0], 'executionSecondsStdev': executionSeconds[1],
+		'peakRssMegabytes': max(run['peakRssMegabytes'] for run in runs),
+		'peakTableNodes': max(run['peakTableNodes'] for run in runs),
+		'log10Estimate': runs[0]['log10Estimate'],
+	}
+
+def isRegression(result, baseline, threshold, minSeconds):
+	# noise floor: short runs are dominated by process startup
+	slower = result['seconds'] > baseline['seconds'] * (1 + threshold) + max(minSeconds, 2 * baseline.get('secondsStdev', 0))
+	bigger = result['peakTableNodes'] > baseline['peakTableNodes'] * (1 + threshold) # deterministic for one thread
+	return slower or bigger
+
+def main():
+	parser = argparse.ArgumentParser(description='DMC benchmark and regression suite')
+	parser.add_argument('dmc', help='dmc binary')
+	parser.add_argument('--formulas', nargs='*', default=defaultFormulas)
+	parser.add_argument('--repeats', type=int, default=3)
+	parser.add_argument('--timeout', type=float, default=600, help='seconds per run')
+	parser.add_argument('--save', help='results file to write, for use as a later baseline')
+	parser.add_argument('--baseline', help='results file of an earlier run')
+	parser.add_argument('--threshold', type=float, default=0.2, help='allowed relative slowdown or growth versus baseline')
+	parser.add_argument('--minSeconds', type=float, default=0.05, help='allowed absolute slowdown versus baseline')
+	parser.add_argument('--tolerance', type=float, default=1e-6, help='allowed log10 difference from base count')
+	args = parser.parse_args()
+
+	baseline = {}
+	if args.baseline:
+		with open(args.baseline) as f:
+			baseline = json.load(f)
+
+	results = {}
+	failures = []
+	print('formula\tconfig\tseconds\tstdev\tpeakRssMegabytes\tpeakTableNodes\tlog10Estimate\tverdict')
+	for formula in args.formulas:
+		name = os.path.relpath(formula, repoDir)
+		baseEstimate = None
+		scalingBaseSeconds = None
+		for configName, config in getConfigs():
+			key = name+' '+configName
+			result = measure(args.dmc, formula, config, args.repeats, args.timeout)
+			verdict = 'ok'
+			if result is None:
+				verdict = 'FAILED'
+			else:
+				results[key] = result
+				estimate = result['log10Estimate']
+				if configName == 'base':
+					baseEstimate = estimate
+				elif baseEstimate is not None and estimate is not None and abs(estimate - baseEstimate) > args.tolerance:
+					verdict = 'MISMATCH'
+				if key in baseline and isRegression(result, baseline[key], args.threshold, args.minSeconds):
+					verdict = 'REGRESSION'
+				if configName.startswith('scaling'):
+					if scalingBaseSeconds is None:
+						scalingBaseSeconds = result['executionSeconds']
+					elif result['executionSeconds'] > 0:
+						verdict += ' speedup=%.2f' % (scalingBaseSeconds / result['executionSeconds'])
+			if not verdict.startswith('ok'):
+				failures.append(key+': '+verdict)
+			if result is None:
+				print(name+'\t'+configName+'\t-\t-\t-\t-\t-\t'+verdict)
+			else:
+				print(name+'\t'+configName+'\t%.3f\t%.3f\t%.1f\t%d\t%s\t%s' % (result['seconds'], result['secondsStdev'], result['peakRssMegabytes'], result['peakTableNodes'], result['log10Estimate'], verdict))
+			sys.stdout.flush()
+
+	if args.save:
+		with open(args.save, 'w') as f:
+			json.dump(results, f, indent=2, sort_keys=True)
+	if failures:
+		print('\n'+str(len(failures))+' failures:')
+		for failure in failures:
+			print(failure)
+		sys.exit(1)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,56 @@
+from sys import argv
+import os
+import random
+import subprocess
+import tempfile
+import time
+
+# scaling benchmark for the HTB planner on random projected 3-CNF formulas with doubling clause counts
+# usage: python3 htbScaling.py <htb binary> [max clause count] [clusteringHeuristic] [clusterVarOrderHeuristic]
+# prints one row per formula: clauses, vars, varOrderSeconds, total planner seconds, join tree width
+
+htb = argv[1]
+maxCls = int(argv[2]) if len(argv) > 2 else 1000000
+ch = argv[3] if len(argv) > 3 else 'bmt'
+cv = argv[4] if len(argv) > 4 else '4' # MCS; LEX_M is quadratic in the var count
+
+def writeCnf(fname, nVars, nCls, seed):
+	rng = random.Random(seed)
+	with open(fname, 'w') as of:
+		of.write('p cnf '+str(nVars)+' '+str(nCls)+'\n')
+		of.write('c p show '+' '.join(str(v) for v in range(1, nVars//5 + 1))+' 0\n')
+		for i in range(nCls):
+			# local clauses keep the primal graph sparse, like the structured benchmarks HTB is used on
+			base = rng.randrange(1, nVars + 1)
+			lits = set()
+			while len(lits) < 3:
+				v = min(nVars, max(1, base + rng.randrange(-20, 21)))
+				lits.add(v if rng.random() < 0.5 else -v)
+			of.write(' '.join(str(l) for l in lits)+' 0\n')
+
+def runHtb(fname):
+	start = time.time()
+	out = subprocess.run([htb, '--cf='+fname, '--pc=1', '--vs=1', '--ch='+ch, '--cv='+cv], capture_output=True, text=True).stdout
+	wall = time.time() - start
+	varOrderSeconds = '-'
+	width = '-'
+	for line in out.splitlines():
+		words = line.split()
+		if len(words) >= 4 and words[2] == 'varOrderSeconds':
+			varOrderSeconds = words[3]
+		elif len(words) == 3 and words[1] == 'joinTreeWidth':
+			width = words[2]
+	return varOrderSeconds, wall, width
+
+print('clauses\tvars\tvarOrderSeconds\tseconds\twidth')
+tmpDir = tempfile.mkdtemp()
+nCls = 1000
+while nCls <= maxCls:
+	nVars = nCls // 4
+	fname = os.path.join(tmpDir, 'rand_'+str(nCls)+'.cnf')
+	writeCnf(fname, nVars, nCls, nCls)
+	varOrderSeconds, wall, width = runHtb(fname)
+	print(str(nCls)+'\t'+str(nVars)+'\t'+varOrderSeconds+'\t'+'%.3f' % wall+'\t'+width)
+	os.remove(fname)
+	nCls *= 2
+os.rmdir(tmpDir)